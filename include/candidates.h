@@ -0,0 +1,39 @@
+#ifndef INCLUDE_CANDIDATES_H_
+#define INCLUDE_CANDIDATES_H_
+
+#include "../include/tsp.h"
+
+/* 2D k-d tree over the instance nodes: implicit layout on a permutation of
+ * the indices, the median of [lo, hi) is the splitter of that subtree */
+typedef struct kdtree_t {
+    int nnodes;
+    node* nodes;
+    int* perm;
+    char* dim; /* split coordinate of the subtree rooted in perm[mid] */
+} * kdtree;
+
+/* candidate lists in compressed rows: neighbors of i, closest first, are
+ * neigh[start[i]], ..., neigh[start[i + 1] - 1] */
+typedef struct candidates_t {
+    enum candidate_types type;
+    int nnodes;
+    int k; /* list length for knn, largest degree for delaunay */
+    int* start;
+    int* neigh;
+} * candidates;
+
+/* k-d tree */
+kdtree kdtree_create(node* nodes, int nnodes);
+int kdtree_knn(kdtree kd, int i, int k, int* out);
+void kdtree_free(kdtree kd);
+
+/* candidate lists */
+candidates candidates_create(instance inst, enum candidate_types type, int k);
+int candidates_size(candidates c, int i);
+int* candidates_list(candidates c, int i);
+void candidates_free(candidates c);
+
+/* build the candidates lists of inst, returns time spent in ms */
+double build_candidates(instance inst);
+
+#endif  // INCLUDE_CANDIDATES_H_
@@ -1,10 +1,16 @@
 #ifndef INCLUDE_CONSTRUCTIVES_H_
 #define INCLUDE_CONSTRUCTIVES_H_
 
+#include "../include/candidates.h"
+#include "../include/pqueue.h"
+#include "../include/rng.h"
 #include "../include/tsp.h"
 
 solution TSPgreedy(instance inst);
-solution TSPgrasp(instance inst, int niterations);
+solution TSPgrasp(instance inst, int niterations, rng* r);
 solution TSPextramileage(instance inst);
 
+double grasp_tour(instance inst, int* succ, double* row, topkqueue tk,
+                  candidates c, double bound, rng* r);
+
 #endif  // INCLUDE_CONSTRUCTIVES_H_
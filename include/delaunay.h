@@ -0,0 +1,26 @@
+#ifndef INCLUDE_DELAUNAY_H_
+#define INCLUDE_DELAUNAY_H_
+
+#include "../include/tsp.h"
+
+/* quad-edge structure of Guibas and Stolfi: directed edge e = 4 * q + r is
+ * the r-th rotation of quad-edge q, even rotations are primal edges */
+typedef struct quadedge_t {
+    int nquads;
+    int capacity;
+    int* onext;
+    int* org; /* node index for the primal edges, -1 for the dual ones */
+    char* alive;
+
+    node* nodes;
+} * quadedge;
+
+quadedge quadedge_create(node* nodes, int capacity);
+void quadedge_free(quadedge qe);
+
+/* delaunay triangulation of the nodes, returns the undirected edges:
+ * duplicated points are triangulated once, the other copies are linked to
+ * the first one and share its neighbors */
+edge* delaunay_triangulation(node* nodes, int nnodes, int* nedges);
+
+#endif  // INCLUDE_DELAUNAY_H_
@@ -0,0 +1,52 @@
+#ifndef INCLUDE_DISTCACHE_H_
+#define INCLUDE_DISTCACHE_H_
+
+#include <stddef.h>
+
+#include "../include/tsp.h"
+
+typedef struct distcache_t {
+    enum distcache_types type;
+    int nnodes;
+    size_t size; /* entries in the packed upper triangle */
+
+    /* only the one matching type is allocated */
+    double* d;
+    float* f;
+    int* r; /* rounded to nearest integer, TSPLIB style */
+} * distcache;
+
+/* bounded cache of whole distance rows, least recently used evicted first.
+ * Rows are filled only when a whole row is asked for: single distances and
+ * short lists are read from a resident row or computed on the spot */
+typedef struct rowcache_t {
+    int nnodes;
+    int nrows; /* capacity */
+    double* rows;
+
+    int* slot;  /* node -> slot holding its row, -1 if not cached */
+    int* owner; /* slot -> node whose row is stored, -1 if free */
+
+    /* lru list over slots: head is the most recently used */
+    int* prev;
+    int* next;
+    int head, tail;
+    int nused;
+
+    long hits, misses;
+} * rowcache;
+
+distcache distcache_create(instance inst, enum distcache_types type);
+double distcache_get(distcache dc, int i, int j);
+void distcache_free(distcache dc);
+
+rowcache rowcache_create(instance inst, int nrows);
+double rowcache_get(rowcache rc, instance inst, int i, int j);
+double* rowcache_row(rowcache rc, instance inst, int i);
+double* rowcache_peek(rowcache rc, int i); /* NULL if not resident */
+void rowcache_free(rowcache rc);
+
+/* build the cache requested in inst->params, returns time spent in ms */
+double build_distcache(instance inst);
+
+#endif  // INCLUDE_DISTCACHE_H_
@@ -19,9 +19,24 @@
 #define SF_K_STEP 2
 #define SF_INITIAL_PERC_TIME 0.2
 
+#define ROWCACHE_PERC_MEMORY 0.5
+
+#define CAND_K 10
+
+#define OROPT_MAXLEN 3
+
+#define LK_MAXDEPTH 50
+#define LK_BREADTH1 5
+#define LK_BREADTH2 3
+
+#define TWOLEVEL_MIN_NODES 10000
+#define TWOLEVEL_MAX_GROUP_FACTOR 4
+
 #define GRASP_K 5
 
 #define TWOOPT_NINITIALSOL 500
+#define MULTISTART_HOPELESS 1.3
+#define MULTISTART_GRASP_SHARE 0.2
 
 #define VNS_K_START 3
 #define VNS_K_MAX 20
@@ -30,6 +45,7 @@
 #define TS_MAX_TENURE 120
 #define TS_MIN_TENURE 20
 #define TS_PHASEDURATION 1000
+#define TS_EDGE_SLOTS 4
 
 #define GENETIC_N 1000
 #define GENETIC_K 100
@@ -38,6 +54,9 @@
 #define GENETIC_NMUTATIONS 300
 #define GENETIC_NMOVES 10
 #define GENETIC_PERC_TIME 0.9
+#define GENETIC_MIN_ISLAND 50
+#define GENETIC_NMIGRANTS 5
+#define GENETIC_MIGRATION_GAP 10
 
 extern int VERBOSE;
 extern int EXTRA_VERBOSE;
@@ -0,0 +1,35 @@
+#ifndef INCLUDE_LK_H_
+#define INCLUDE_LK_H_
+
+#include "../include/candidates.h"
+#include "../include/globals.h"
+#include "../include/tour.h"
+#include "../include/tsp.h"
+
+/* state of a lin-kernighan move: t1 is fixed, every step is a 2opt flip
+ * (t2, t1), (t3, t4) -> (t2, t3), (t1, t4) so that the tour is always
+ * closed by (t1, t4), and t4 becomes the t2 of the next step */
+typedef struct lksearch_t {
+    instance inst;
+    tour t;
+    candidates c;
+
+    int t1;
+    int depth;
+    int flips[4 * LK_MAXDEPTH]; /* t2, t1, t3, t4 of each step */
+    int added[2 * LK_MAXDEPTH];
+    int removed[2 * (LK_MAXDEPTH + 1)];
+
+    /* best closed tour along the current chain of flips */
+    double best;
+    int bestdepth;
+} * lksearch;
+
+solution TSPlinkernighan(instance inst);
+
+/* lk from every node in a don't look bits queue */
+double lk_refinement(instance inst, int* succ, int nnodes, struct timespec* s,
+                     struct timespec* e);
+double lk_move(lksearch lk, int t1);
+
+#endif  // INCLUDE_LK_H_
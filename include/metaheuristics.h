@@ -1,11 +1,84 @@
 #ifndef INCLUDE_METAHEURISTICS_H_
 #define INCLUDE_METAHEURISTICS_H_
 
+#include "../include/candidates.h"
+#include "../include/rng.h"
+#include "../include/tour.h"
 #include "../include/tsp.h"
+#include "../include/utils.h"
+
+/* 2opt moves of the neighbor lists tabu search: slot p of the candidate
+ * lists, with j = neigh[p] a candidate of i = row[p], gives the 4 moves
+ * 4 * p + m adding (i, j) and removing an edge of i and one of j. The deltas
+ * change only when the tour edges of i or j do, the orientation of the tour
+ * tells which 2 of the 4 moves are valid at each pick */
+typedef struct tabu_moves_t {
+    int nnodes;
+    candidates c;
+    int* row;
+    int* nbr; /* tour neighbors of v, nbr[2 * v] < nbr[2 * v + 1] */
+    int* rstart; /* slots with j = v are rslot[rstart[v]], ... */
+    int* rslot;
+
+    double* delta; /* INFINITY if never a 2opt move */
+    char* orient;
+} * tabu_moves;
+
+/* genetic island on a single arena: tour id has its successors in
+ * succ + id * nnodes. ids[0], ..., ids[npop - 1] are the population, the
+ * last noffspring ids the offspring of the current generation. Each island
+ * draws from its own stream, the scratch buffers make a generation
+ * allocation free */
+typedef struct genetic_t {
+    int nnodes;
+    int npop;
+    int noffspring;
+    int size;
+    rng r;
+    int* succ;
+    double* zstar;
+    int* ids;
+
+    /* scratch */
+    int* chromosome;
+    char* visited;
+    double* dsucc;
+    pair* objs;
+    char* elite;
+
+    /* eax scratch, NULL with the order crossover: A-only and B-only edges
+     * and the child as 2 neighbors per node, the AB-cycles one after the
+     * other in cycles with their starts in cstart, the walk building them
+     * with the position of each node on it by parity. comp labels the
+     * subtours of the child, csize and cnode their size and a node on each */
+    int* aedges;
+    int* bedges;
+    int* link;
+    int* cycles;
+    int* cstart;
+    int* walk;
+    int* walkpos;
+    int* comp;
+    int* csize;
+    int* cnode;
+} * genetic;
 
 solution TSPvns(instance inst, int* succ);
 solution TSPtabusearch(instance inst, int* succ);
 solution TSPgenetic(instance inst);
 
+/* cached deltas of the candidate 2opt moves */
+tabu_moves tabu_moves_create(instance inst, tour t);
+void tabu_moves_update(tabu_moves tm, instance inst, tour t, int* touched,
+                       int ntouched);
+double tabu_moves_pick(tabu_moves tm, instance inst, tour t, int* tabu_to,
+                       int* tabu_since, int tenure, int k, double aspiration,
+                       int* a, int* an, int* b, int* bn);
+void tabu_moves_free(tabu_moves tm);
+
+/* genetic arena */
+genetic genetic_create(instance inst, int npop, int stream);
+void genetic_free(genetic ga);
+
 #endif  // INCLUDE_METAHEURISTICS_H_
 
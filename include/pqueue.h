@@ -3,27 +3,39 @@
 
 #include <stddef.h>
 
+#include "../include/rng.h"
+
 enum modes { MAX_HEAP, MIN_HEAP };
 
 typedef struct pqueue_node_t {
     double key;
     int val;
-} * pqueue_node;
+} pqueue_node;
 
+/* binary heap on a flat array. The indexed queues hold each val in
+ * [0, nvals) at most once and track its position, for the key updates and
+ * the removals */
 typedef struct pqueue_t {
-    struct pqueue_node_t** data;
+    pqueue_node* data;
     int size;
     int capacity;
     enum modes mode;
+
+    int nvals;
+    int* pos; /* -1 if val is not in the queue, NULL if not indexed */
 } * pqueue;
 
+/* the k smallest keys pushed, sorted in flat arrays allocated once */
 typedef struct topkqueue_t {
-    pqueue pq;
     int k;
+    int size;
+    double* keys;
+    int* vals;
 } * topkqueue;
 
 /* priority queue operations */
 pqueue pqueue_create(enum modes mode);
+pqueue pqueue_create_indexed(enum modes mode, int nvals);
 int pqueue_empty(pqueue pq);
 int pqueue_top(pqueue pq);
 double pqueue_top_key(pqueue pq);
@@ -32,12 +44,17 @@ void pqueue_push(pqueue pq, double key, int val);
 void pqueue_print(pqueue pq);
 void pqueue_free(pqueue pq);
 
-/* topkqueue: wrapper of priority list which mantains only the top-k elements */
+/* indexed queues only */
+int pqueue_contains(pqueue pq, int val);
+double pqueue_key(pqueue pq, int val);
+void pqueue_decrease_key(pqueue pq, int val, double key);
+void pqueue_remove(pqueue pq, int val);
+
+/* topkqueue: mantains only the top-k elements, no allocation after create */
 topkqueue topkqueue_create(int k);
 void topkqueue_push(topkqueue tk, double key, int val);
-int topkqueue_randompick(topkqueue tk);
+int topkqueue_randompick(topkqueue tk, rng* r);
 void topkqueue_print(topkqueue tk);
 void topkqueue_free(topkqueue tk);
 
-
 #endif  // INCLUDE_PQUEUE_H_
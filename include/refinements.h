@@ -1,26 +1,94 @@
 #ifndef INCLUDE_REFINEMENTS_H_
 #define INCLUDE_REFINEMENTS_H_
 
+#include "../include/lk.h"
+#include "../include/rng.h"
+#include "../include/tour.h"
 #include "../include/tsp.h"
 
+/* best move of each row of the best improvement 2opt, the pairs (i, j) with
+ * j > i. A move changes the successor of the nodes of a segment only: just
+ * the rows of those nodes, or whose best partner is one of them, are scanned
+ * again, the others only against the changed nodes */
+typedef struct twoopt_cache_t {
+    int nnodes;
+    int noadjacent; /* skip j = succ[i] and succ[j] = i, for the tabu search */
+    double* dsucc;
+    int* pred;
+    double* penalty; /* INFINITY for the nodes kept out of the moves */
+    double* delta;
+    int* partner;
+
+    /* nodes changed by the last update */
+    int* changed;
+    char* ischanged;
+} * twoopt_cache;
+
 solution TSPtwoopt_multistart(instance inst);
 solution TSPthreeopt_multistart(instance inst);
+/* grasp starts refined on every thread until the time limit, the best tour
+ * goes in sol: 3opt for THREEOPT_MULTISTART, lk for LIN_KERNIGHAN, the -R
+ * refinement otherwise */
+void multistart(instance inst, solution sol, enum model_types model_type);
 
 double twoopt_delta(instance inst, int* succ, int i, int j);
 
-double twoopt_pick(instance inst, int* succ, int* a, int* b);
-double twoopt_tabu_pick(instance inst, int* succ, int* tabu_nodes, int tenure,
-                        int k, int* a, int* b);
+/* best 2opt move (a, b) of the whole tour, negative if improving: dsucc is
+ * scratch of nnodes for the tour edges lengths */
+double twoopt_pick(instance inst, int* succ, double* dsucc, int* a, int* b);
 void twoopt_move(int* succ, int nnodes, int a, int b);
-double threeopt_pick(instance inst, int* succ, int* a, int* b, int* c,
-                     struct timespec* s, struct timespec* e);
-void threeopt_move(int* succ, int nnodes, int a, int b, int c, instance inst);
+
+twoopt_cache twoopt_cache_create(instance inst, int* succ, int noadjacent);
+void twoopt_cache_free(twoopt_cache tc);
+double twoopt_cache_pick(twoopt_cache tc, int* a, int* b);
+void twoopt_cache_move(twoopt_cache tc, instance inst, int* succ, int a,
+                       int b);
+void twoopt_cache_allow(twoopt_cache tc, instance inst, int* succ,
+                        char* allowed);
 
 double twoopt_refinement_notimelim(instance inst, int* succ, int nnodes);
 double twoopt_refinement(instance inst, int* succ, int nnodes,
                          struct timespec* s, struct timespec* e);
+/* first improvement 3opt on the candidate lists, with don't look bits */
 double threeopt_refinement(instance inst, int* succ, int nnodes,
-                         struct timespec* s, struct timespec* e);
-void kick(int* succ, int nnodes, int strength);
+                           struct timespec* s, struct timespec* e);
+/* first improvement 2opt on the candidate lists, with don't look bits */
+double twoopt_neighbor_refinement(instance inst, int* succ, int nnodes,
+                                  struct timespec* s, struct timespec* e);
+
+/* or-opt: segments of up to OROPT_MAXLEN nodes, possibly reversed, moved
+ * next to one of their candidate neighbors */
+double oropt_delta(instance inst, tour t, int s1, int s2, int l,
+                   int reversed);
+void oropt_move(tour t, int s1, int s2, int l, int reversed);
+double oropt_refinement(instance inst, int* succ, int nnodes,
+                        struct timespec* s, struct timespec* e);
+
+/* local search selected by the refinement_type param */
+double refine(instance inst, int* succ, int nnodes, struct timespec* s,
+              struct timespec* e);
+/* local search from the seeds only, as after a kick: the tour and the
+ * don't look bits queue live across the calls, so a kick and its repair
+ * cost O(k * neighbors) instead of O(n) */
+typedef struct localsearch_t {
+    instance inst;
+    candidates c;
+    tour t;
+
+    int* queue;
+    char* inqueue;
+    int head, tail, size;
+
+    lksearch lk; /* LK_REFINEMENT only */
+} * localsearch;
+
+localsearch localsearch_create(instance inst, int* succ);
+void localsearch_free(localsearch ls);
+double refine_from(localsearch ls, int* seeds, int nseeds, struct timespec* s,
+                   struct timespec* e);
+/* random reconnection of strength tour segments, double bridge for 3. The
+ * removed edges, then the added ones, are stored in kicked (4 * strength
+ * nodes) if not NULL */
+void kick(tour t, int strength, rng* r, int* kicked);
 
 #endif  // INCLUDE_REFINEMENTS_H_
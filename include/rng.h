@@ -0,0 +1,17 @@
+#ifndef INCLUDE_RNG_H_
+#define INCLUDE_RNG_H_
+
+#include <stdint.h>
+
+/* xoshiro256** generator: a state per worker, no lock shared with libc's
+ * rand(). The stream tells apart the workers seeded with the same seed */
+typedef struct rng_t {
+    uint64_t s[4];
+} rng;
+
+void rng_seed(rng* r, int seed, int stream);
+uint64_t rng_next(rng* r);
+int rng_int(rng* r, int n); /* uniform in [0, n) */
+double rng_double(rng* r);  /* uniform in [0, 1) */
+
+#endif  // INCLUDE_RNG_H_
@@ -0,0 +1,35 @@
+#ifndef INCLUDE_TOUR_H_
+#define INCLUDE_TOUR_H_
+
+struct twolevel_t;
+
+/* array tour: order[p] is the node in position p, pos[v] the position of
+ * node v. The orientation is not preserved by the moves, which reverse the
+ * shorter side of the tour. Large tours are kept in a two-level list
+ * instead (tl not NULL, order and pos unused) */
+typedef struct tour_t {
+    int nnodes;
+    int* order;
+    int* pos;
+
+    struct twolevel_t* tl;
+} * tour;
+
+/* manipulators */
+tour tour_create(int nnodes);
+tour tour_from_succ(int* succ, int nnodes);
+void tour_to_succ(tour t, int* succ);
+void tour_load_succ(tour t, int* succ);
+void tour_free(tour t);
+
+/* queries */
+int tour_next(tour t, int v);
+int tour_prev(tour t, int v);
+int tour_between(tour t, int a, int b, int c);
+
+/* moves */
+void tour_reverse(tour t, int a, int b);
+void tour_make2opt(tour t, int t1, int t2, int t3, int t4);
+void tour_make3opt(tour t, int a, int b, int c, int reconnection);
+
+#endif  // INCLUDE_TOUR_H_
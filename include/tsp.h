@@ -6,12 +6,36 @@
 #include "../include/tracker.h"
 
 struct solution_t;
+struct distcache_t;
+struct rowcache_t;
+struct candidates_t;
+
+enum distcache_types {
+    NO_CACHE,
+    DOUBLE_CACHE,
+    FLOAT_CACHE,
+    INT_CACHE,
+    ROW_CACHE
+};
+enum candidate_types { KNN_CANDIDATES, DELAUNAY_CANDIDATES };
+enum refinement_types {
+    TWOOPT_REFINEMENT,
+    TWOOPT_NEIGHBOR_REFINEMENT,
+    OROPT_REFINEMENT,
+    LK_REFINEMENT
+};
+enum crossover_types { ORDER_CROSSOVER, EAX_CROSSOVER };
 
 typedef struct cplex_params_t {
     int randomseed;
     int num_threads;
     double timelimit;
     int available_memory;
+    enum distcache_types distance_cache;
+    enum candidate_types candidate_type;
+    enum refinement_types refinement_type;
+    enum crossover_types crossover_type;
+    int neighbor_lists; /* grasp and tabu search on the candidate lists */
 } * cplex_params;
 
 enum model_folders { TSPLIB, GENERATED };
@@ -41,6 +65,19 @@ typedef struct instance_t {
     int ncols;
     node* nodes;
 
+    /* structure of arrays copy of the nodes for the batch distances: plain
+     * coordinates and, for GEO only, their cosines and sines */
+    double* xs;
+    double* ys;
+    double *cosx, *sinx, *cosy, *siny;
+
+    /* distances caches (NULL if not requested) */
+    struct distcache_t* dcache;
+    struct rowcache_t* rcache;
+
+    /* sparse neighborhoods, nearest first */
+    struct candidates_t* cands;
+
     /* solutions */
     double zbest;
     int nsols;
@@ -76,7 +113,8 @@ enum model_types {
     VNS_GRASP,
     TABU_SEACH_RANDOM,
     TABU_SEACH_GRASP,
-    GENETIC
+    GENETIC,
+    LIN_KERNIGHAN
 };
 typedef struct solution_t {
     struct instance_t* inst;
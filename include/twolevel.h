@@ -0,0 +1,51 @@
+#ifndef INCLUDE_TWOLEVEL_H_
+#define INCLUDE_TWOLEVEL_H_
+
+/* two-level doubly-linked list tour: the tour is cut into about sqrt(n)
+ * segments, each one a linked list of nodes with a reversal bit, and the
+ * segments form a ring. Links and ids of the nodes follow the internal
+ * orientation of their segment, the reversal bit tells how to read them */
+typedef struct twolevel_t {
+    int nnodes;
+    int nsegs;
+    int maxsegs; /* rebuild when reached */
+    int groupsize;
+
+    /* nodes */
+    int* seg;
+    int* id; /* consecutive inside a segment, increasing along nxt */
+    int* nxt;
+    int* prv; /* -1 at the internal ends of the segment */
+
+    /* segments */
+    int* first; /* internal head and tail */
+    int* last;
+    int* size;
+    char* rev;
+    int* rank; /* position in the ring */
+    int* snext;
+    int* sprev;
+
+    /* buffers: run of segments being reversed, tour order on rebuilds */
+    int* run;
+    int* order;
+    int unbalanced;
+} * twolevel;
+
+/* manipulators */
+twolevel twolevel_create(int* succ, int nnodes);
+void twolevel_load_succ(twolevel tl, int* succ);
+void twolevel_to_succ(twolevel tl, int* succ);
+void twolevel_free(twolevel tl);
+
+/* queries, O(1) but reachable which is O(sqrt(n)) */
+int twolevel_next(twolevel tl, int v);
+int twolevel_prev(twolevel tl, int v);
+int twolevel_between(twolevel tl, int a, int b, int c);
+int twolevel_reachable(twolevel tl, int i, int j);
+
+/* moves, O(sqrt(n)) */
+void twolevel_reverse_path(twolevel tl, int start, int end);
+void twolevel_make2opt(twolevel tl, int t1, int t2, int t3, int t4);
+
+#endif  // INCLUDE_TWOLEVEL_H_
@@ -1,6 +1,7 @@
 #ifndef INCLUDE_UTILS_H_
 #define INCLUDE_UTILS_H_
 
+#include "../include/rng.h"
 #include "../include/tsp.h"
 
 /* cplex position helpers */
@@ -12,8 +13,25 @@ edge xpos_inverse(int pos, int nnodes);
 
 /* compute distances and zstar from tour */
 double dist(int i, int j, instance inst);
+double dist_compute(int i, int j, instance inst); /* bypass the caches */
+
+/* batch distances: out[k] = dist(i, first + k) or dist(i, js[k]), vectorized
+ * on the structure of arrays copy of the nodes when available */
+void build_nodes_soa(instance inst);
+void dist_row(instance inst, int i, int first, int count, double* out);
+void dist_many(instance inst, int i, const int* js, int count, double* out);
+void dist_row_compute(instance inst, int i, int first, int count,
+                      double* out); /* bypass the caches */
 double compute_zstar(instance inst, solution sol);
 
+/* best 2opt move (i, j) over j in [first, first + count): delta is
+ * d(i, j) + d(succ[i], succ[j]) - (dsucc[i] + dsucc[j]) + penalty[j], first
+ * j on ties, INFINITY and -1 if none. AVX2/AVX-512 when twoopt_row_fast */
+int twoopt_row_fast(instance inst);
+double twoopt_row_best(instance inst, int* succ, const double* dsucc,
+                       const double* penalty, int i, int first, int count,
+                       int* bestj);
+
 /* graphs utils */
 int reachable(int* succ, int i, int j);
 int visitable(int* succ, int nnodes);
@@ -23,7 +41,7 @@ void reverse_path(int* succ, int nnodes, int start, int end);
 int* edges_tosucc(edge* edges, int nnodes);
 
 /* generate random solution */
-int* randomtour(int nnodes, unsigned int seedp);
+int* randomtour(int nnodes, rng* r);
 
 /* compare functions */
 typedef struct pair_t {
@@ -32,6 +50,7 @@ typedef struct pair_t {
 } pair;
 int wedgecmp(const void* a, const void* b);
 int nodelexcmp(const void* a, const void* b);
+int nodeidxcmp(const void* a, const void* b, void* data);
 int pathcmp(const void* a, const void* b, void* data);
 int stringcmp(const void* a, const void* b);
 int paircmp(const void* a, const void* b);
@@ -43,6 +62,13 @@ int ccw(node a, node b, node c);
 /* quick string helpers */
 char* model_type_tostring(enum model_types model_type);
 char* model_folder_tostring(enum model_folders folder);
+char* distcache_type_tostring(enum distcache_types type);
+char* candidate_type_tostring(enum candidate_types type);
+char* refinement_type_tostring(enum refinement_types type);
+char* crossover_type_tostring(enum crossover_types type);
+
+/* threads for the parallel heuristics: the -C param, every core if unset */
+int heuristic_threads(instance inst);
 
 /* wall clock trackers */
 int64_t stopwatch(struct timespec* s, struct timespec* e);
@@ -1,72 +1,46 @@
 #include "../include/approximations.h"
 
 #include <assert.h>
+#include <string.h>
 
+#include "../include/candidates.h"
 #include "../include/globals.h"
 #include "../include/union_find.h"
 #include "../include/utils.h"
 
+/* sparse mst helpers */
+void mst_candidates(instance inst, edge* tree);
+int mst_kruskal(instance inst, candidates c, union_find uf, edge* tree);
+int mst_prim(instance inst, edge* tree);
+int mst_listed(candidates c, int i, int j);
+void mst_preorder(edge* tree, int nnodes, int* order);
+
 solution TSPminspantree(instance inst) {
     assert(inst != NULL);
 
     int nnodes = inst->nnodes;
-    int nedges = nnodes * (nnodes - 1) / 2;
 
     solution sol = create_solution(inst, MST, nnodes);
     sol->distance_time = 0.0;
 
-    /* build weighted edge list and sort it */
-    wedge* wedges = (wedge*)malloc(nedges * sizeof(struct wedge_t));
-    for (int i = 0; i < nnodes; i++) {
-        for (int j = i + 1; j < nnodes; j++) {
-            wedges[xpos(i, j, nnodes)] = (wedge){dist(i, j, inst), i, j};
-        }
-    }
-    qsort(wedges, nedges, sizeof(struct wedge_t), wedgecmp);
+    /* minimum spanning tree and its preorder visit, the tour shortcuts it */
+    edge* tree = (edge*)malloc(maxi(nnodes - 1, 1) * sizeof(struct edge_t));
+    mst_candidates(inst, tree);
 
-    /* itearate over the edges and create the mst */
-    union_find uf = uf_create(nnodes);
-    for (int k = 0; k < nedges; k++) {
-        int i, j;
-        i = wedges[k].i;
-        j = wedges[k].j;
+    int* order = (int*)malloc(nnodes * sizeof(int));
+    mst_preorder(tree, nnodes, order);
 
-        if (uf_same_set(uf, i, j)) continue;
-
-        uf_union_set(uf, i, j);
-    }
+    int* succ = (int*)malloc(nnodes * sizeof(int));
+    for (int i = 0; i < nnodes; i++) succ[order[i]] = order[(i + 1) % nnodes];
 
-    /* save the solution: pre/post order visit the tree and save the nodes
-     * encountered, starting from the uf root */
-    sol->zstar = 0.0;
-    int prev, next;
-    prev = -1;
-    int i = 0;
-    while (uf_postorder(uf, &next)) {
-        if (prev != -1) {
-            sol->edges[i] = (edge){prev, next};
-            sol->zstar += dist(prev, next, inst);
-
-            i++;
-        }
-        prev = next;
-    }
-    /* do not forget to close the loop! */
-    sol->edges[i] = (edge){prev, sol->edges[0].i};
-    sol->zstar += dist(prev, sol->edges[0].i, inst);
-
-    /* refine it! */
-    int* succ;
-    if ((succ = edges_tosucc(sol->edges, nnodes)) == NULL) {
-        print_error("solver didnt produced a tour");
-    }
-    // sol->zstar += twoopt_refinement(inst, succ, nnodes);
-    /* sol->zstar += threeopt_refinement(inst, succ, nnodes); */
     /* store the succ as usual edges array */
+    sol->zstar = 0.0;
     for (int j = 0; j < nnodes; j++) {
         sol->edges[j] = (edge){j, succ[j]};
+        sol->zstar += dist(j, succ[j], inst);
     }
     free(succ);
+    free(order);
 
     if (EXTRA_VERBOSE) {
         /* add the spanning tree to the solution */
@@ -76,25 +50,11 @@ solution TSPminspantree(instance inst) {
         sol->edges =
             (edge*)realloc(sol->edges, sol->nedges * sizeof(struct edge_t));
 
-        int msti = 1 + sol->nedges / 2; /* index of mst edge to add */
-        int* visited = (int*)calloc(nnodes, sizeof(int));
-        for (int j = 0; j < nnodes; j++) {
-            if (visited[j]) continue;
-
-            /* visit the node and store all the exiting edges */
-            visited[j] = 1;
-            for (int k = 0; k < uf->tns[j]->size; k++) {
-                if (visited[uf->tns[j]->sons[k]]) continue;
-
-                sol->edges[msti] = (edge){j, uf->tns[j]->sons[k]};
-
-                msti++;
-            }
+        for (int j = 0; j < nnodes - 1; j++) {
+            sol->edges[nnodes + j] = tree[j];
         }
-        free(visited);
 
-        /* yeah i could reuse visitd and flip the bit, but this is executed just
-         * one.. let me do this pls */
+        /* tree edges in the second color */
         int* edgecolors = (int*)calloc(sol->nedges, sizeof(int));
         for (int j = 1 + sol->nedges / 2; j < sol->nedges; j++) {
             edgecolors[j] = 1;
@@ -109,8 +69,157 @@ solution TSPminspantree(instance inst) {
         sol->edges = realloc(sol->edges, sol->nedges * sizeof(struct edge_t));
     }
 
-    free(wedges);
-    uf_free(uf);
+    free(tree);
 
     return sol;
 }
+
+void mst_candidates(instance inst, edge* tree) {
+    /* kruskal on the delaunay edges: they hold a euclidean mst, which stays
+     * minimal under the monotone roundings of EUC_2D and ATT. The other
+     * weights get no such subgraph: plain O(n^2) prim */
+    int nnodes = inst->nnodes;
+    int ntree = 0;
+
+    if (inst->nodes != NULL &&
+        (inst->weight_type == EUC_2D || inst->weight_type == ATT)) {
+        candidates c = inst->cands;
+        if (c == NULL || c->type != DELAUNAY_CANDIDATES) {
+            c = candidates_create(inst, DELAUNAY_CANDIDATES, 1);
+        }
+
+        union_find uf = uf_create(nnodes);
+        ntree = mst_kruskal(inst, c, uf, tree);
+        if (uf->nsets > 1) {
+            if (VERBOSE) {
+                printf("[VERBOSE] delaunay graph split in %d components\n",
+                       uf->nsets);
+            }
+            ntree = 0;
+        }
+
+        uf_free(uf);
+        if (c != inst->cands) candidates_free(c);
+    }
+
+    if (ntree == 0) ntree = mst_prim(inst, tree);
+    assert(ntree == nnodes - 1);
+}
+
+int mst_prim(instance inst, edge* tree) {
+    /* dense prim from node 0: O(n) memory, each distance computed once */
+    int nnodes = inst->nnodes;
+    double* d = (double*)malloc(nnodes * sizeof(double));
+    int* from = (int*)malloc(nnodes * sizeof(int));
+    for (int v = 1; v < nnodes; v++) {
+        d[v] = dist(0, v, inst);
+        from[v] = 0;
+    }
+
+    int ntree = 0;
+    for (int left = nnodes - 1; left > 0; left--) {
+        int best = -1;
+        for (int v = 1; v < nnodes; v++) {
+            if (from[v] >= 0 && (best < 0 || d[v] < d[best])) best = v;
+        }
+
+        tree[ntree++] = (edge){from[best], best};
+        from[best] = -1;
+
+        for (int v = 1; v < nnodes; v++) {
+            if (from[v] < 0) continue;
+
+            double w = dist(best, v, inst);
+            if (w < d[v]) {
+                d[v] = w;
+                from[v] = best;
+            }
+        }
+    }
+
+    free(d);
+    free(from);
+
+    return ntree;
+}
+
+int mst_kruskal(instance inst, candidates c, union_find uf, edge* tree) {
+    int nnodes = inst->nnodes;
+
+    /* candidate pairs once, the lists of i and j may both hold them */
+    wedge* wedges =
+        (wedge*)malloc(maxi(c->start[nnodes], 1) * sizeof(struct wedge_t));
+    int nedges = 0;
+    for (int i = 0; i < nnodes; i++) {
+        int* list = candidates_list(c, i);
+        for (int h = 0; h < candidates_size(c, i); h++) {
+            int j = list[h];
+            if (j < i && mst_listed(c, j, i)) continue;
+
+            wedges[nedges++] = (wedge){dist(i, j, inst), i, j};
+        }
+    }
+    qsort(wedges, nedges, sizeof(struct wedge_t), wedgecmp);
+
+    int ntree = 0;
+    for (int k = 0; k < nedges && uf->nsets > 1; k++) {
+        int i = wedges[k].i, j = wedges[k].j;
+        if (uf_same_set(uf, i, j)) continue;
+
+        uf_union_set(uf, i, j);
+        tree[ntree++] = (edge){i, j};
+    }
+    free(wedges);
+
+    return ntree;
+}
+
+int mst_listed(candidates c, int i, int j) {
+    int* list = candidates_list(c, i);
+    for (int h = 0; h < candidates_size(c, i); h++) {
+        if (list[h] == j) return 1;
+    }
+    return 0;
+}
+
+void mst_preorder(edge* tree, int nnodes, int* order) {
+    /* tree edges to adjacency arrays, then an iterative dfs from node 0 */
+    int* start = (int*)calloc(nnodes + 1, sizeof(int));
+    int* adj = (int*)malloc(maxi(2 * (nnodes - 1), 1) * sizeof(int));
+    for (int e = 0; e < nnodes - 1; e++) {
+        start[tree[e].i + 1]++;
+        start[tree[e].j + 1]++;
+    }
+    for (int i = 0; i < nnodes; i++) start[i + 1] += start[i];
+
+    int* fill = (int*)malloc(nnodes * sizeof(int));
+    memcpy(fill, start, nnodes * sizeof(int));
+    for (int e = 0; e < nnodes - 1; e++) {
+        adj[fill[tree[e].i]++] = tree[e].j;
+        adj[fill[tree[e].j]++] = tree[e].i;
+    }
+
+    /* each node is pushed once, by its parent */
+    int* stack = fill;
+    char* visited = (char*)calloc(nnodes, sizeof(char));
+    int size = 0, norder = 0;
+    stack[size++] = 0;
+    visited[0] = 1;
+    while (size > 0) {
+        int v = stack[--size];
+        order[norder++] = v;
+
+        for (int h = start[v + 1] - 1; h >= start[v]; h--) {
+            if (visited[adj[h]]) continue;
+
+            visited[adj[h]] = 1;
+            stack[size++] = adj[h];
+        }
+    }
+    assert(norder == nnodes);
+
+    free(start);
+    free(adj);
+    free(stack);
+    free(visited);
+}
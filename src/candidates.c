@@ -0,0 +1,352 @@
+#include "../include/candidates.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/delaunay.h"
+#include "../include/globals.h"
+#include "../include/utils.h"
+
+/* k-d tree helpers */
+double kdtree_coord(kdtree kd, int i, int d);
+int kdtree_less(kdtree kd, int i, int j, int d);
+void kdtree_select(kdtree kd, int lo, int hi, int nth, int d);
+void kdtree_build(kdtree kd, int lo, int hi);
+void kdtree_search(kdtree kd, int lo, int hi, int q, int k, double* hkeys,
+                   int* hvals, int* hsize);
+
+/* bounded max heap of the k closest found so far */
+void knnheap_push(double* hkeys, int* hvals, int* hsize, int k, double key,
+                  int val);
+
+/* order a list by the instance metric, ties by index */
+void candidates_sort(instance inst, int i, int* list, int size);
+int candpaircmp(const void* a, const void* b);
+
+/* k-d tree helpers */
+double kdtree_coord(kdtree kd, int i, int d) {
+    return d == 0 ? kd->nodes[i].x : kd->nodes[i].y;
+}
+int kdtree_less(kdtree kd, int i, int j, int d) {
+    /* ties broken by index: duplicated points still split evenly */
+    double ci = kdtree_coord(kd, i, d);
+    double cj = kdtree_coord(kd, j, d);
+
+    return ci < cj || (ci == cj && i < j);
+}
+void kdtree_select(kdtree kd, int lo, int hi, int nth, int d) {
+    /* quickselect on perm[lo, hi): perm[nth] ends in its sorted position */
+    int* perm = kd->perm;
+
+    while (hi - lo > 1) {
+        int pivot = perm[lo + (hi - lo) / 2];
+        int i = lo, j = hi - 1;
+
+        while (i <= j) {
+            while (kdtree_less(kd, perm[i], pivot, d)) i++;
+            while (kdtree_less(kd, pivot, perm[j], d)) j--;
+            if (i <= j) {
+                swap(&perm[i], &perm[j]);
+                i++;
+                j--;
+            }
+        }
+
+        if (nth <= j) {
+            hi = j + 1;
+        } else if (nth >= i) {
+            lo = i;
+        } else {
+            return;
+        }
+    }
+}
+void kdtree_build(kdtree kd, int lo, int hi) {
+    if (hi - lo <= 1) return;
+
+    /* split along the coordinate with the largest spread */
+    double minx = INF, maxx = -INF, miny = INF, maxy = -INF;
+    for (int i = lo; i < hi; i++) {
+        node p = kd->nodes[kd->perm[i]];
+        minx = min(minx, p.x);
+        maxx = max(maxx, p.x);
+        miny = min(miny, p.y);
+        maxy = max(maxy, p.y);
+    }
+    int d = (maxx - minx) >= (maxy - miny) ? 0 : 1;
+
+    int mid = lo + (hi - lo) / 2;
+    kdtree_select(kd, lo, hi, mid, d);
+    kd->dim[mid] = d;
+
+    kdtree_build(kd, lo, mid);
+    kdtree_build(kd, mid + 1, hi);
+}
+void kdtree_search(kdtree kd, int lo, int hi, int q, int k, double* hkeys,
+                   int* hvals, int* hsize) {
+    if (lo >= hi) return;
+
+    int mid = lo + (hi - lo) / 2;
+    int p = kd->perm[mid];
+
+    if (p != q) {
+        double dx = kd->nodes[p].x - kd->nodes[q].x;
+        double dy = kd->nodes[p].y - kd->nodes[q].y;
+        knnheap_push(hkeys, hvals, hsize, k, dx * dx + dy * dy, p);
+    }
+    if (hi - lo == 1) return;
+
+    /* closer side first, the other only if the splitting line is closer
+     * than the worst neighbor found so far */
+    int d = kd->dim[mid];
+    double diff = kdtree_coord(kd, q, d) - kdtree_coord(kd, p, d);
+    int left_first = kdtree_less(kd, q, p, d);
+
+    if (left_first) {
+        kdtree_search(kd, lo, mid, q, k, hkeys, hvals, hsize);
+    } else {
+        kdtree_search(kd, mid + 1, hi, q, k, hkeys, hvals, hsize);
+    }
+
+    if (*hsize < k || diff * diff <= hkeys[0]) {
+        if (left_first) {
+            kdtree_search(kd, mid + 1, hi, q, k, hkeys, hvals, hsize);
+        } else {
+            kdtree_search(kd, lo, mid, q, k, hkeys, hvals, hsize);
+        }
+    }
+}
+
+void knnheap_push(double* hkeys, int* hvals, int* hsize, int k, double key,
+                  int val) {
+    int i;
+
+    if (*hsize < k) {
+        /* room left: shift up */
+        i = (*hsize)++;
+        while (i > 0 && hkeys[(i - 1) / 2] < key) {
+            hkeys[i] = hkeys[(i - 1) / 2];
+            hvals[i] = hvals[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+    } else {
+        /* full: replace the farthest if closer, then shift down */
+        if (key >= hkeys[0]) return;
+
+        i = 0;
+        while (2 * i + 1 < k) {
+            int c = 2 * i + 1;
+            if (c + 1 < k && hkeys[c + 1] > hkeys[c]) c++;
+            if (hkeys[c] <= key) break;
+
+            hkeys[i] = hkeys[c];
+            hvals[i] = hvals[c];
+            i = c;
+        }
+    }
+
+    hkeys[i] = key;
+    hvals[i] = val;
+}
+
+kdtree kdtree_create(node* nodes, int nnodes) {
+    assert(nodes != NULL);
+
+    kdtree kd = (kdtree)calloc(1, sizeof(struct kdtree_t));
+    kd->nnodes = nnodes;
+    kd->nodes = nodes;
+    kd->perm = (int*)malloc(nnodes * sizeof(int));
+    kd->dim = (char*)calloc(nnodes, sizeof(char));
+
+    for (int i = 0; i < nnodes; i++) kd->perm[i] = i;
+    kdtree_build(kd, 0, nnodes);
+
+    return kd;
+}
+
+int kdtree_knn(kdtree kd, int i, int k, int* out) {
+    assert(kd != NULL);
+
+    k = mini(k, kd->nnodes - 1);
+    if (k <= 0) return 0;
+
+    double* hkeys = (double*)malloc(k * sizeof(double));
+    int* hvals = (int*)malloc(k * sizeof(int));
+    int hsize = 0;
+
+    kdtree_search(kd, 0, kd->nnodes, i, k, hkeys, hvals, &hsize);
+
+    /* pop the heap backwards: closest first */
+    while (hsize > 0) {
+        out[hsize - 1] = hvals[0];
+        double key = hkeys[hsize - 1];
+        int val = hvals[hsize - 1];
+        hsize--;
+
+        int j = 0;
+        while (2 * j + 1 < hsize) {
+            int c = 2 * j + 1;
+            if (c + 1 < hsize && hkeys[c + 1] > hkeys[c]) c++;
+            if (hkeys[c] <= key) break;
+
+            hkeys[j] = hkeys[c];
+            hvals[j] = hvals[c];
+            j = c;
+        }
+        hkeys[j] = key;
+        hvals[j] = val;
+    }
+
+    free(hkeys);
+    free(hvals);
+
+    return k;
+}
+
+void kdtree_free(kdtree kd) {
+    if (kd == NULL) return;
+
+    free(kd->perm);
+    free(kd->dim);
+
+    free(kd);
+}
+
+/* candidate lists */
+candidates candidates_create(instance inst, enum candidate_types type, int k) {
+    assert(inst != NULL);
+    assert(inst->nodes != NULL);
+    assert(k > 0);
+
+    int nnodes = inst->nnodes;
+
+    candidates c = (candidates)calloc(1, sizeof(struct candidates_t));
+    c->type = type;
+    c->nnodes = nnodes;
+    c->k = k;
+    c->start = (int*)malloc((nnodes + 1) * sizeof(int));
+
+    switch (type) {
+        case KNN_CANDIDATES: {
+            int len = mini(k, nnodes - 1);
+            c->neigh = (int*)malloc((size_t)nnodes * len * sizeof(int));
+
+            kdtree kd = kdtree_create(inst->nodes, nnodes);
+
+            c->start[0] = 0;
+            for (int i = 0; i < nnodes; i++) {
+                int* list = c->neigh + c->start[i];
+                int size = kdtree_knn(kd, i, len, list);
+
+                /* the tree works on plain coordinates: GEO is approximate */
+                candidates_sort(inst, i, list, size);
+
+                c->start[i + 1] = c->start[i] + size;
+            }
+
+            kdtree_free(kd);
+            break;
+        }
+
+        case DELAUNAY_CANDIDATES: {
+            int nedges;
+            edge* edges = delaunay_triangulation(inst->nodes, nnodes, &nedges);
+
+            /* undirected edges to compressed rows */
+            intset(c->start, 0, nnodes + 1);
+            for (int e = 0; e < nedges; e++) {
+                c->start[edges[e].i + 1]++;
+                c->start[edges[e].j + 1]++;
+            }
+            for (int i = 0; i < nnodes; i++) c->start[i + 1] += c->start[i];
+
+            c->neigh = (int*)malloc(maxi(2 * nedges, 1) * sizeof(int));
+            int* fill = (int*)malloc(nnodes * sizeof(int));
+            memcpy(fill, c->start, nnodes * sizeof(int));
+            for (int e = 0; e < nedges; e++) {
+                c->neigh[fill[edges[e].i]++] = edges[e].j;
+                c->neigh[fill[edges[e].j]++] = edges[e].i;
+            }
+
+            /* no fixed length here: k is the largest degree */
+            c->k = 0;
+            for (int i = 0; i < nnodes; i++) {
+                candidates_sort(inst, i, candidates_list(c, i),
+                                candidates_size(c, i));
+                c->k = maxi(c->k, candidates_size(c, i));
+            }
+
+            free(fill);
+            free(edges);
+            break;
+        }
+    }
+
+    return c;
+}
+
+void candidates_sort(instance inst, int i, int* list, int size) {
+    if (size < 2) return;
+
+    double* w = (double*)malloc(size * sizeof(double));
+    pair* p = (pair*)malloc(size * sizeof(pair));
+
+    dist_many(inst, i, list, size, w);
+    for (int a = 0; a < size; a++) p[a] = (pair){w[a], list[a]};
+    qsort(p, size, sizeof(pair), candpaircmp);
+    for (int a = 0; a < size; a++) list[a] = p[a].x;
+
+    free(w);
+    free(p);
+}
+int candpaircmp(const void* a, const void* b) {
+    pair* pa = (pair*)a;
+    pair* pb = (pair*)b;
+
+    if (pa->w != pb->w) return pa->w < pb->w ? -1 : 1;
+    return pa->x - pb->x;
+}
+
+int candidates_size(candidates c, int i) {
+    return c->start[i + 1] - c->start[i];
+}
+int* candidates_list(candidates c, int i) { return c->neigh + c->start[i]; }
+
+void candidates_free(candidates c) {
+    if (c == NULL) return;
+
+    free(c->start);
+    free(c->neigh);
+
+    free(c);
+}
+
+double build_candidates(instance inst) {
+    assert(inst != NULL);
+    assert(inst->params != NULL);
+
+    /* already there or nothing to build on */
+    enum candidate_types type = inst->params->candidate_type;
+    if (inst->cands != NULL && inst->cands->type == type) return 0.0;
+    if (inst->nodes == NULL || inst->nnodes < 2) return 0.0;
+
+    struct timespec s, e;
+    s.tv_sec = e.tv_sec = -1;
+    stopwatch_n(&s, &e);
+
+    candidates_free(inst->cands);
+    inst->cands = candidates_create(inst, type, CAND_K);
+
+    double elapsed = stopwatch_n(&s, &e) / 1e6;
+    if (VERBOSE) {
+        char* type_str = candidate_type_tostring(type);
+        printf("[VERBOSE] %s candidates built in %.3lf ms\n", type_str,
+               elapsed);
+        free(type_str);
+    }
+
+    return elapsed;
+}
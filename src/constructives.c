@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include "../include/constructives.h"
 
 #include <assert.h>
@@ -5,6 +7,7 @@
 #include <string.h>
 #include <time.h>
 
+#include "../include/candidates.h"
 #include "../include/globals.h"
 #include "../include/pqueue.h"
 #include "../include/utils.h"
@@ -21,6 +24,8 @@ solution TSPgreedy(instance inst) {
 
     /* succ used as visited: if -1 means not visited */
     int* succ = (int*)malloc(nnodes * sizeof(int));
+    /* distances from the last visited node, computed in a single batch */
+    double* row = (double*)malloc(nnodes * sizeof(double));
 
     /* initialize total wall-clock time */
     struct timespec s, e;
@@ -47,14 +52,15 @@ solution TSPgreedy(instance inst) {
             double weight = DBL_MAX;
 
             /* search for best new node */
+            dist_row(inst, act, 0, nnodes, row);
             for (int i = 0; i < nnodes; i++) {
                 if (succ[i] != -1) continue;
                 if (i == act) continue;
 
                 /* update best new edge */
-                if (dist(act, i, inst) < weight) {
+                if (row[i] < weight) {
                     next = i;
-                    weight = dist(act, i, inst);
+                    weight = row[i];
                 }
             }
 
@@ -85,17 +91,23 @@ solution TSPgreedy(instance inst) {
     }
 
     free(succ);
+    free(row);
 
     return sol;
 }
 
-solution TSPgrasp(instance inst, int niterations) {
+solution TSPgrasp(instance inst, int niterations, rng* r) {
     assert(inst != NULL);
     assert(inst->params != NULL);
 
     int nnodes = inst->nnodes;
-    srand(time(NULL));
-    unsigned int seedp = time(NULL);
+
+    /* without a caller generator, a stream of the run seed */
+    rng own;
+    if (r == NULL) {
+        rng_seed(&own, inst->params->randomseed, 0);
+        r = &own;
+    }
 
     /* track the best solution up to this point */
     solution sol = create_solution(inst, GRASP, nnodes);
@@ -107,6 +119,14 @@ solution TSPgrasp(instance inst, int niterations) {
     topkqueue tk = topkqueue_create(GRASP_K);
     /* succ used as visited: if -1 means not visited */
     int* succ = (int*)malloc(nnodes * sizeof(int));
+    /* distances from the last visited node, computed in a single batch */
+    double* row = (double*)malloc(nnodes * sizeof(double));
+    /* with the neighbor lists, the choices are the candidates of the node */
+    candidates c = NULL;
+    if (inst->params->neighbor_lists) {
+        build_candidates(inst);
+        c = inst->cands;
+    }
 
     /* initialize total wall-clock time */
     struct timespec s, e;
@@ -116,42 +136,7 @@ solution TSPgrasp(instance inst, int niterations) {
     /* iterate over staring point (randomly) until timelimit */
     int k = 0;
     while (stopwatch(&s, &e) / 1000.0 < inst->params->timelimit) {
-        /* reset succ */
-        memset(succ, -1, nnodes * sizeof(int));
-
-        /* generate starting point to the actual tour */
-        int start, act, next;
-        start = act = rand_r(&seedp) % nnodes;
-        double obj = 0.0;
-
-        if (EXTRA_VERBOSE) printf("[VERBOSE] grasp start %d\n", start + 1);
-
-        /* loop over nodes to visit: nodes -1 for start */
-        int nunvisited = nnodes - 1;
-        while (nunvisited--) {
-            /* search for best new node */
-            for (int i = 0; i < nnodes; i++) {
-                if (succ[i] != -1) continue;
-                if (i == act) continue; /* act is not visited yet */
-
-                /* update top-k queue*/
-                topkqueue_push(tk, dist(i, act, inst), i);
-            }
-
-            /* add the best new edge to the tour */
-            next = topkqueue_randompick(tk);
-            succ[act] = next;
-            obj += dist(act, next, inst);
-
-            /* if (EXTRA_VERBOSE) printf("\tnext: %d, obj: %lf\n", next + 1, obj); */
-
-            act = next;
-        }
-        /* do not forget to close the loop! */
-        succ[next] = start;
-        obj += dist(next, start, inst);
-
-        if (EXTRA_VERBOSE) printf(" -> obj: %lf\n", obj);
+        double obj = grasp_tour(inst, succ, row, tk, c, DBL_MAX, r);
 
         /* select best tour */
         if (obj < sol->zstar) {
@@ -169,10 +154,71 @@ solution TSPgrasp(instance inst, int niterations) {
 
     topkqueue_free(tk);
     free(succ);
+    free(row);
 
     return sol;
 }
 
+double grasp_tour(instance inst, int* succ, double* row, topkqueue tk,
+                  candidates c, double bound, rng* r) {
+    /* a single grasp construction on the caller buffers: DBL_MAX as soon as
+     * the partial tour reaches bound. With candidates, the unvisited
+     * neighbors of the last node only, all the nodes once they are over */
+    int nnodes = inst->nnodes;
+
+    /* reset succ */
+    memset(succ, -1, nnodes * sizeof(int));
+
+    /* generate starting point to the actual tour */
+    int start, act, next;
+    start = act = rng_int(r, nnodes);
+    double obj = 0.0;
+
+    if (EXTRA_VERBOSE) printf("[VERBOSE] grasp start %d\n", start + 1);
+
+    /* loop over nodes to visit: nodes -1 for start */
+    int nunvisited = nnodes - 1;
+    while (nunvisited--) {
+        /* search for best new node */
+        if (c != NULL) {
+            int* list = candidates_list(c, act);
+            int ncands = candidates_size(c, act);
+            for (int h = 0; h < ncands; h++) {
+                int i = list[h];
+                if (succ[i] != -1 || i == act) continue;
+
+                topkqueue_push(tk, dist(act, i, inst), i);
+            }
+        }
+        if (tk->size == 0) {
+            dist_row(inst, act, 0, nnodes, row);
+            for (int i = 0; i < nnodes; i++) {
+                if (succ[i] != -1) continue;
+                if (i == act) continue; /* act is not visited yet */
+
+                /* update top-k queue*/
+                topkqueue_push(tk, row[i], i);
+            }
+        }
+
+        /* add the best new edge to the tour */
+        next = topkqueue_randompick(tk, r);
+        succ[act] = next;
+        obj += dist(act, next, inst);
+
+        if (obj >= bound) return DBL_MAX;
+
+        act = next;
+    }
+    /* do not forget to close the loop! */
+    succ[next] = start;
+    obj += dist(next, start, inst);
+
+    if (EXTRA_VERBOSE) printf(" -> obj: %lf\n", obj);
+
+    return obj;
+}
+
 solution TSPextramileage(instance inst) {
     assert(inst != NULL);
 
@@ -187,34 +233,37 @@ solution TSPextramileage(instance inst) {
     s.tv_sec = e.tv_sec = -1;
     stopwatch(&s, &e);
 
-    /* andew's monothone chain algorithm for convex */
+    /* andew's monothone chain algorithm for convex: sort the indices, not
+     * the nodes, so distance caches keep matching the instance */
     int k = 0;
     int* H = (int*)malloc(nnodes * 2 * sizeof(int));
-    qsort(inst->nodes, nnodes, sizeof(struct node_t), nodelexcmp);
+    int* sorted = (int*)malloc(nnodes * sizeof(int));
+    for (int i = 0; i < nnodes; i++) sorted[i] = i;
+    qsort_r(sorted, nnodes, sizeof(int), nodeidxcmp, inst->nodes);
 
     for (int i = 0; i < nnodes; i++) {
         while (k >= 2) {
             node a, b, c;
             a = inst->nodes[H[k - 2]];
             b = inst->nodes[H[k - 1]];
-            c = inst->nodes[i];
+            c = inst->nodes[sorted[i]];
             if (ccw(a, b, c)) break;
 
             k--;
         }
-        H[k++] = i;
+        H[k++] = sorted[i];
     }
     for (int i = nnodes - 2, t = k + 1; i >= 0; i--) {
         while (k >= t) {
             node a, b, c;
             a = inst->nodes[H[k - 2]];
             b = inst->nodes[H[k - 1]];
-            c = inst->nodes[i];
+            c = inst->nodes[sorted[i]];
             if (ccw(a, b, c)) break;
 
             k--;
         }
-        H[k++] = i;
+        H[k++] = sorted[i];
     }
     int nhull = k; /* for EXTRA section */
     /* note: H closes the loop! */
@@ -299,6 +348,7 @@ solution TSPextramileage(instance inst) {
     }
 
     free(visited);
+    free(sorted);
     free(H);
 
     return sol;
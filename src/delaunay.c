@@ -0,0 +1,351 @@
+#define _GNU_SOURCE
+#include "../include/delaunay.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/globals.h"
+#include "../include/utils.h"
+
+/* quad-edge algebra */
+int qe_rot(int e);
+int qe_sym(int e);
+int qe_rotinv(int e);
+int qe_onext(quadedge qe, int e);
+int qe_oprev(quadedge qe, int e);
+int qe_lnext(quadedge qe, int e);
+int qe_rprev(quadedge qe, int e);
+int qe_org(quadedge qe, int e);
+int qe_dest(quadedge qe, int e);
+
+/* quad-edge topological operators */
+int qe_make_edge(quadedge qe, int a, int b);
+void qe_splice(quadedge qe, int a, int b);
+int qe_connect(quadedge qe, int a, int b);
+void qe_delete_edge(quadedge qe, int e);
+
+/* geometric predicates */
+int qe_leftof(quadedge qe, int x, int e);
+int qe_rightof(quadedge qe, int x, int e);
+int qe_valid(quadedge qe, int e, int basel);
+int strict_ccw(node a, node b, node c);
+int incircle(node a, node b, node c, node d);
+int nodeexactcmp(const void* a, const void* b, void* data);
+
+/* divide and conquer on the nodes idx[lo, hi) sorted lexicographically,
+ * le and re are the ccw convex hull edges out of the leftmost and the
+ * rightmost node */
+void delaunay_dc(quadedge qe, int* idx, int lo, int hi, int* le, int* re);
+
+/* quad-edge algebra */
+int qe_rot(int e) { return (e & ~3) | ((e + 1) & 3); }
+int qe_sym(int e) { return (e & ~3) | ((e + 2) & 3); }
+int qe_rotinv(int e) { return (e & ~3) | ((e + 3) & 3); }
+int qe_onext(quadedge qe, int e) { return qe->onext[e]; }
+int qe_oprev(quadedge qe, int e) {
+    return qe_rot(qe->onext[qe_rot(e)]);
+}
+int qe_lnext(quadedge qe, int e) {
+    return qe_rot(qe->onext[qe_rotinv(e)]);
+}
+int qe_rprev(quadedge qe, int e) { return qe->onext[qe_sym(e)]; }
+int qe_org(quadedge qe, int e) { return qe->org[e]; }
+int qe_dest(quadedge qe, int e) { return qe->org[qe_sym(e)]; }
+
+quadedge quadedge_create(node* nodes, int capacity) {
+    quadedge qe = (quadedge)calloc(1, sizeof(struct quadedge_t));
+    qe->nodes = nodes;
+    qe->nquads = 0;
+    qe->capacity = maxi(capacity, 1);
+    qe->onext = (int*)malloc(4 * qe->capacity * sizeof(int));
+    qe->org = (int*)malloc(4 * qe->capacity * sizeof(int));
+    qe->alive = (char*)malloc(qe->capacity * sizeof(char));
+
+    return qe;
+}
+
+void quadedge_free(quadedge qe) {
+    if (qe == NULL) return;
+
+    free(qe->onext);
+    free(qe->org);
+    free(qe->alive);
+
+    free(qe);
+}
+
+/* quad-edge topological operators */
+int qe_make_edge(quadedge qe, int a, int b) {
+    if (qe->nquads == qe->capacity) {
+        qe->capacity *= 2;
+        qe->onext = (int*)realloc(qe->onext, 4 * qe->capacity * sizeof(int));
+        qe->org = (int*)realloc(qe->org, 4 * qe->capacity * sizeof(int));
+        qe->alive = (char*)realloc(qe->alive, qe->capacity * sizeof(char));
+    }
+
+    int q = qe->nquads++;
+    int e = 4 * q;
+
+    /* isolated edge: primal rings are trivial, dual ones are swapped */
+    qe->onext[e] = e;
+    qe->onext[e + 1] = e + 3;
+    qe->onext[e + 2] = e + 2;
+    qe->onext[e + 3] = e + 1;
+
+    qe->org[e] = a;
+    qe->org[e + 1] = -1;
+    qe->org[e + 2] = b;
+    qe->org[e + 3] = -1;
+
+    qe->alive[q] = 1;
+
+    return e;
+}
+void qe_splice(quadedge qe, int a, int b) {
+    int alpha = qe_rot(qe->onext[a]);
+    int beta = qe_rot(qe->onext[b]);
+
+    swap(&qe->onext[a], &qe->onext[b]);
+    swap(&qe->onext[alpha], &qe->onext[beta]);
+}
+int qe_connect(quadedge qe, int a, int b) {
+    /* new edge from the destination of a to the origin of b */
+    int e = qe_make_edge(qe, qe_dest(qe, a), qe_org(qe, b));
+    qe_splice(qe, e, qe_lnext(qe, a));
+    qe_splice(qe, qe_sym(e), b);
+
+    return e;
+}
+void qe_delete_edge(quadedge qe, int e) {
+    qe_splice(qe, e, qe_oprev(qe, e));
+    qe_splice(qe, qe_sym(e), qe_oprev(qe, qe_sym(e)));
+    qe->alive[e >> 2] = 0;
+}
+
+/* geometric predicates */
+int qe_leftof(quadedge qe, int x, int e) {
+    return strict_ccw(qe->nodes[x], qe->nodes[qe_org(qe, e)],
+               qe->nodes[qe_dest(qe, e)]);
+}
+int qe_rightof(quadedge qe, int x, int e) {
+    return strict_ccw(qe->nodes[x], qe->nodes[qe_dest(qe, e)],
+               qe->nodes[qe_org(qe, e)]);
+}
+int qe_valid(quadedge qe, int e, int basel) {
+    return qe_rightof(qe, qe_dest(qe, e), basel);
+}
+int strict_ccw(node a, node b, node c) {
+    /* no tolerance, unlike ccw: tiny triangles of dense instances count */
+    node ba = (node){b.x - a.x, b.y - a.y};
+    node ca = (node){c.x - a.x, c.y - a.y};
+
+    return cross(ba, ca) > 0.0;
+}
+int incircle(node a, node b, node c, node d) {
+    /* d strictly inside the circle through a, b, c in ccw order */
+    double adx = a.x - d.x, ady = a.y - d.y;
+    double bdx = b.x - d.x, bdy = b.y - d.y;
+    double cdx = c.x - d.x, cdy = c.y - d.y;
+
+    double det = (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy) +
+                 (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy) +
+                 (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+
+    return det > 0.0;
+}
+
+int nodeexactcmp(const void* a, const void* b, void* data) {
+    /* strict lexicographic order, nodeidxcmp tolerance would break the
+     * vertical splits */
+    node na = ((node*)data)[*((int*)a)];
+    node nb = ((node*)data)[*((int*)b)];
+
+    if (na.x != nb.x) return na.x < nb.x ? -1 : 1;
+    if (na.y != nb.y) return na.y < nb.y ? -1 : 1;
+    return 0;
+}
+
+void delaunay_dc(quadedge qe, int* idx, int lo, int hi, int* le, int* re) {
+    node* nodes = qe->nodes;
+    int n = hi - lo;
+
+    if (n == 2) {
+        int a = qe_make_edge(qe, idx[lo], idx[lo + 1]);
+        *le = a;
+        *re = qe_sym(a);
+        return;
+    }
+    if (n == 3) {
+        int s1 = idx[lo], s2 = idx[lo + 1], s3 = idx[lo + 2];
+        int a = qe_make_edge(qe, s1, s2);
+        int b = qe_make_edge(qe, s2, s3);
+        qe_splice(qe, qe_sym(a), b);
+
+        /* close the triangle unless the three nodes are collinear */
+        if (strict_ccw(nodes[s1], nodes[s2], nodes[s3])) {
+            qe_connect(qe, b, a);
+            *le = a;
+            *re = qe_sym(b);
+        } else if (strict_ccw(nodes[s1], nodes[s3], nodes[s2])) {
+            int c = qe_connect(qe, b, a);
+            *le = qe_sym(c);
+            *re = c;
+        } else {
+            *le = a;
+            *re = qe_sym(b);
+        }
+        return;
+    }
+
+    int mid = lo + n / 2;
+    int ldo, ldi, rdi, rdo;
+    delaunay_dc(qe, idx, lo, mid, &ldo, &ldi);
+    delaunay_dc(qe, idx, mid, hi, &rdi, &rdo);
+
+    /* lower common tangent of the two halves */
+    while (1) {
+        if (qe_leftof(qe, qe_org(qe, rdi), ldi)) {
+            ldi = qe_lnext(qe, ldi);
+        } else if (qe_rightof(qe, qe_org(qe, ldi), rdi)) {
+            rdi = qe_rprev(qe, rdi);
+        } else {
+            break;
+        }
+    }
+
+    int basel = qe_connect(qe, qe_sym(rdi), ldi);
+    if (qe_org(qe, ldi) == qe_org(qe, ldo)) ldo = qe_sym(basel);
+    if (qe_org(qe, rdi) == qe_org(qe, rdo)) rdo = basel;
+
+    /* merge: zip the halves bottom up, removing the edges that fail the
+     * empty circle test */
+    while (1) {
+        int lcand = qe_onext(qe, qe_sym(basel));
+        if (qe_valid(qe, lcand, basel)) {
+            while (incircle(nodes[qe_dest(qe, basel)], nodes[qe_org(qe, basel)],
+                            nodes[qe_dest(qe, lcand)],
+                            nodes[qe_dest(qe, qe_onext(qe, lcand))])) {
+                int t = qe_onext(qe, lcand);
+                qe_delete_edge(qe, lcand);
+                lcand = t;
+            }
+        }
+
+        int rcand = qe_oprev(qe, basel);
+        if (qe_valid(qe, rcand, basel)) {
+            while (incircle(nodes[qe_dest(qe, basel)], nodes[qe_org(qe, basel)],
+                            nodes[qe_dest(qe, rcand)],
+                            nodes[qe_dest(qe, qe_oprev(qe, rcand))])) {
+                int t = qe_oprev(qe, rcand);
+                qe_delete_edge(qe, rcand);
+                rcand = t;
+            }
+        }
+
+        int lvalid = qe_valid(qe, lcand, basel);
+        int rvalid = qe_valid(qe, rcand, basel);
+        if (!lvalid && !rvalid) break;
+
+        if (!lvalid ||
+            (rvalid && incircle(nodes[qe_dest(qe, lcand)],
+                                nodes[qe_org(qe, lcand)],
+                                nodes[qe_org(qe, rcand)],
+                                nodes[qe_dest(qe, rcand)]))) {
+            basel = qe_connect(qe, rcand, qe_sym(basel));
+        } else {
+            basel = qe_connect(qe, qe_sym(basel), qe_sym(lcand));
+        }
+    }
+
+    *le = ldo;
+    *re = rdo;
+}
+
+edge* delaunay_triangulation(node* nodes, int nnodes, int* nedges) {
+    assert(nodes != NULL);
+    assert(nedges != NULL);
+
+    /* sort lexicographically and drop the duplicated points */
+    int* idx = (int*)malloc(nnodes * sizeof(int));
+    for (int i = 0; i < nnodes; i++) idx[i] = i;
+    qsort_r(idx, nnodes, sizeof(int), nodeexactcmp, nodes);
+
+    int* first = (int*)malloc(nnodes * sizeof(int));
+    int nunique = 0;
+    for (int k = 0; k < nnodes; k++) {
+        int i = idx[k];
+        if (nunique > 0) {
+            node p = nodes[idx[nunique - 1]];
+            if (p.x == nodes[i].x && p.y == nodes[i].y) {
+                first[i] = idx[nunique - 1];
+                continue;
+            }
+        }
+        first[i] = i;
+        idx[nunique++] = i;
+    }
+
+    /* triangulate: at most 3n - 6 edges survive, some more are deleted */
+    int ntri = 0;
+    int* tri = NULL;
+    if (nunique >= 2) {
+        quadedge qe = quadedge_create(nodes, 3 * nunique);
+        int le, re;
+        delaunay_dc(qe, idx, 0, nunique, &le, &re);
+
+        tri = (int*)malloc(2 * qe->nquads * sizeof(int));
+        for (int q = 0; q < qe->nquads; q++) {
+            if (!qe->alive[q]) continue;
+            tri[2 * ntri] = qe->org[4 * q];
+            tri[2 * ntri + 1] = qe->org[4 * q + 2];
+            ntri++;
+        }
+
+        quadedge_free(qe);
+    }
+
+    /* adjacency of the first copies, to give their neighbors to the others */
+    int* adjstart = (int*)calloc(nnodes + 1, sizeof(int));
+    for (int k = 0; k < 2 * ntri; k++) adjstart[tri[k] + 1]++;
+    for (int i = 0; i < nnodes; i++) adjstart[i + 1] += adjstart[i];
+
+    int* adj = (int*)malloc(maxi(2 * ntri, 1) * sizeof(int));
+    int* fill = (int*)malloc(nnodes * sizeof(int));
+    memcpy(fill, adjstart, nnodes * sizeof(int));
+    for (int k = 0; k < 2 * ntri; k++) adj[fill[tri[k]]++] = tri[k ^ 1];
+
+    int nextra = 0;
+    for (int i = 0; i < nnodes; i++) {
+        int f = first[i];
+        if (f != i) nextra += 1 + adjstart[f + 1] - adjstart[f];
+    }
+
+    *nedges = ntri + nextra;
+    edge* edges = (edge*)malloc(maxi(*nedges, 1) * sizeof(edge));
+
+    int m = 0;
+    for (int k = 0; k < ntri; k++) {
+        edges[m++] = (edge){tri[2 * k], tri[2 * k + 1]};
+    }
+    for (int i = 0; i < nnodes; i++) {
+        int f = first[i];
+        if (f == i) continue;
+
+        edges[m++] = (edge){f, i};
+        for (int k = adjstart[f]; k < adjstart[f + 1]; k++) {
+            edges[m++] = (edge){i, adj[k]};
+        }
+    }
+    assert(m == *nedges);
+
+    free(idx);
+    free(first);
+    free(tri);
+    free(adjstart);
+    free(adj);
+    free(fill);
+
+    return edges;
+}
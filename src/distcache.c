@@ -0,0 +1,285 @@
+#include "../include/distcache.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/globals.h"
+#include "../include/utils.h"
+
+size_t distcache_pos(int i, int j, int nnodes);
+size_t distcache_entry_size(enum distcache_types type);
+
+/* lru helpers */
+void rowcache_unlink(rowcache rc, int s);
+void rowcache_push_front(rowcache rc, int s);
+
+size_t distcache_pos(int i, int j, int nnodes) {
+    /* same packed upper triangle as xpos, but safe from int overflow */
+    if (i > j) return distcache_pos(j, i, nnodes);
+
+    return (size_t)i * nnodes + j - ((size_t)(i + 1) * (i + 2)) / 2;
+}
+size_t distcache_entry_size(enum distcache_types type) {
+    switch (type) {
+        case DOUBLE_CACHE:
+            return sizeof(double);
+        case FLOAT_CACHE:
+            return sizeof(float);
+        case INT_CACHE:
+            return sizeof(int);
+        case ROW_CACHE:
+        case NO_CACHE:
+            break;
+    }
+
+    return 0;
+}
+
+distcache distcache_create(instance inst, enum distcache_types type) {
+    assert(inst != NULL);
+    assert(inst->nodes != NULL);
+    assert(type != NO_CACHE && type != ROW_CACHE);
+
+    int nnodes = inst->nnodes;
+
+    distcache dc = (distcache)calloc(1, sizeof(struct distcache_t));
+    dc->type = type;
+    dc->nnodes = nnodes;
+    dc->size = (size_t)nnodes * (nnodes - 1) / 2;
+
+    switch (type) {
+        case DOUBLE_CACHE:
+            dc->d = (double*)malloc(dc->size * sizeof(double));
+            break;
+        case FLOAT_CACHE:
+            dc->f = (float*)malloc(dc->size * sizeof(float));
+            break;
+        case INT_CACHE:
+            dc->r = (int*)malloc(dc->size * sizeof(int));
+            break;
+        case ROW_CACHE:
+        case NO_CACHE:
+            break;
+    }
+    if (dc->d == NULL && dc->f == NULL && dc->r == NULL) {
+        print_error("not enough memory for the distance cache");
+    }
+
+    /* row by row the packed positions are consecutive */
+    double* row = (double*)malloc(nnodes * sizeof(double));
+    size_t k = 0;
+    for (int i = 0; i < nnodes; i++) {
+        int count = nnodes - i - 1;
+        dist_row_compute(inst, i, i + 1, count, row);
+
+        for (int j = 0; j < count; j++) {
+            switch (type) {
+                case DOUBLE_CACHE:
+                    dc->d[k] = row[j];
+                    break;
+                case FLOAT_CACHE:
+                    dc->f[k] = (float)row[j];
+                    break;
+                case INT_CACHE:
+                    dc->r[k] = (int)(row[j] + 0.5);
+                    break;
+                case ROW_CACHE:
+                case NO_CACHE:
+                    break;
+            }
+            k++;
+        }
+    }
+    free(row);
+
+    return dc;
+}
+
+double distcache_get(distcache dc, int i, int j) {
+    size_t pos = distcache_pos(i, j, dc->nnodes);
+
+    switch (dc->type) {
+        case DOUBLE_CACHE:
+            return dc->d[pos];
+        case FLOAT_CACHE:
+            return dc->f[pos];
+        case INT_CACHE:
+            return dc->r[pos];
+        case ROW_CACHE:
+        case NO_CACHE:
+            break;
+    }
+
+    return 0.0; /* warning suppressor */
+}
+
+void distcache_free(distcache dc) {
+    if (dc == NULL) return;
+
+    free(dc->d);
+    free(dc->f);
+    free(dc->r);
+
+    free(dc);
+}
+
+rowcache rowcache_create(instance inst, int nrows) {
+    assert(inst != NULL);
+    assert(inst->nodes != NULL);
+
+    int nnodes = inst->nnodes;
+    nrows = maxi(2, mini(nrows, nnodes));
+
+    rowcache rc = (rowcache)calloc(1, sizeof(struct rowcache_t));
+    rc->nnodes = nnodes;
+    rc->nrows = nrows;
+    rc->rows = (double*)malloc((size_t)nrows * nnodes * sizeof(double));
+    if (rc->rows == NULL) print_error("not enough memory for the row cache");
+
+    rc->slot = (int*)malloc(nnodes * sizeof(int));
+    intset(rc->slot, -1, nnodes);
+    rc->owner = (int*)malloc(nrows * sizeof(int));
+    intset(rc->owner, -1, nrows);
+
+    rc->prev = (int*)malloc(nrows * sizeof(int));
+    rc->next = (int*)malloc(nrows * sizeof(int));
+    rc->head = rc->tail = -1;
+    rc->nused = 0;
+
+    rc->hits = rc->misses = 0;
+
+    return rc;
+}
+
+void rowcache_unlink(rowcache rc, int s) {
+    if (rc->prev[s] != -1) {
+        rc->next[rc->prev[s]] = rc->next[s];
+    } else {
+        rc->head = rc->next[s];
+    }
+    if (rc->next[s] != -1) {
+        rc->prev[rc->next[s]] = rc->prev[s];
+    } else {
+        rc->tail = rc->prev[s];
+    }
+}
+void rowcache_push_front(rowcache rc, int s) {
+    rc->prev[s] = -1;
+    rc->next[s] = rc->head;
+    if (rc->head != -1) rc->prev[rc->head] = s;
+    rc->head = s;
+    if (rc->tail == -1) rc->tail = s;
+}
+
+double* rowcache_peek(rowcache rc, int i) {
+    int s = rc->slot[i];
+    if (s == -1) {
+        rc->misses++;
+        return NULL;
+    }
+
+    /* hit: just mark it as the most recent */
+    rc->hits++;
+    if (rc->head != s) {
+        rowcache_unlink(rc, s);
+        rowcache_push_front(rc, s);
+    }
+    return rc->rows + (size_t)s * rc->nnodes;
+}
+
+double* rowcache_row(rowcache rc, instance inst, int i) {
+    double* cached = rowcache_peek(rc, i);
+    if (cached != NULL) return cached;
+
+    /* miss: take a free slot or evict the least recently used row */
+    int s;
+    if (rc->nused < rc->nrows) {
+        s = rc->nused++;
+    } else {
+        s = rc->tail;
+        rowcache_unlink(rc, s);
+        rc->slot[rc->owner[s]] = -1;
+    }
+    rc->owner[s] = i;
+    rc->slot[i] = s;
+    rowcache_push_front(rc, s);
+
+    double* row = rc->rows + (size_t)s * rc->nnodes;
+    dist_row_compute(inst, i, 0, rc->nnodes, row);
+
+    return row;
+}
+
+double rowcache_get(rowcache rc, instance inst, int i, int j) {
+    /* distances are symmetric: any of the two rows will do. A single
+     * distance never pays for a whole row, it is computed on a miss */
+    if (rc->slot[i] == -1 && rc->slot[j] != -1) swap(&i, &j);
+
+    double* row = rowcache_peek(rc, i);
+    return row != NULL ? row[j] : dist_compute(i, j, inst);
+}
+
+void rowcache_free(rowcache rc) {
+    if (rc == NULL) return;
+
+    free(rc->rows);
+    free(rc->slot);
+    free(rc->owner);
+    free(rc->prev);
+    free(rc->next);
+
+    free(rc);
+}
+
+double build_distcache(instance inst) {
+    assert(inst != NULL);
+    assert(inst->params != NULL);
+
+    enum distcache_types type = inst->params->distance_cache;
+
+    /* nothing requested: no time spent */
+    if (type == NO_CACHE) return 0.0;
+    if (inst->nodes == NULL) return 0.0;
+
+    int nnodes = inst->nnodes;
+    double budget = inst->params->available_memory * 1024.0 * 1024.0;
+
+    /* the packed triangle must fit in the available memory, otherwise fall
+     * back to a row cache sized on the same budget */
+    if (type != ROW_CACHE) {
+        double bytes = (double)nnodes * (nnodes - 1) / 2 *
+                       distcache_entry_size(type);
+        if (bytes > budget) {
+            if (VERBOSE) {
+                printf("[VERBOSE] distance cache needs %.0lf MB, using rows\n",
+                       bytes / (1024.0 * 1024.0));
+            }
+            type = ROW_CACHE;
+        }
+    }
+
+    /* already there, the fallback row cache too */
+    if (inst->dcache != NULL && inst->dcache->type == type) return 0.0;
+    if (inst->rcache != NULL && type == ROW_CACHE) return 0.0;
+
+    struct timespec s, e;
+    s.tv_sec = e.tv_sec = -1;
+    stopwatch_n(&s, &e);
+
+    distcache_free(inst->dcache);
+    rowcache_free(inst->rcache);
+    inst->dcache = NULL;
+    inst->rcache = NULL;
+
+    if (type == ROW_CACHE) {
+        double rowbytes = (double)nnodes * sizeof(double);
+        int nrows = (int)min(nnodes, ROWCACHE_PERC_MEMORY * budget / rowbytes);
+        inst->rcache = rowcache_create(inst, nrows);
+    } else {
+        inst->dcache = distcache_create(inst, type);
+    }
+
+    return stopwatch_n(&s, &e) / 1e6;
+}
@@ -0,0 +1,229 @@
+#include "../include/lk.h"
+
+#include <assert.h>
+#include <float.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/refinements.h"
+#include "../include/utils.h"
+
+/* lk step helpers */
+void lk_step(lksearch lk, int t2, double g);
+void lk_undo(lksearch lk);
+int lk_isadded(lksearch lk, int u, int v);
+int lk_isremoved(lksearch lk, int u, int v);
+
+solution TSPlinkernighan(instance inst) {
+    assert(inst != NULL);
+    assert(inst->params != NULL);
+
+    /* track the best solution up to this point */
+    solution sol = create_solution(inst, LIN_KERNIGHAN, inst->nnodes);
+    sol->distance_time = 0.0;
+    sol->zstar = DBL_MAX;
+
+    /* grasp starts under the shared deadline, as the 2opt multistart */
+    multistart(inst, sol, LIN_KERNIGHAN);
+
+    return sol;
+}
+
+double lk_refinement(instance inst, int* succ, int nnodes, struct timespec* s,
+                     struct timespec* e) {
+    assert(inst != NULL);
+    assert(succ != NULL);
+
+    double improvement = 0.0;
+    if (nnodes < 8) return improvement;
+
+    build_candidates(inst);
+
+    lksearch lk = (lksearch)calloc(1, sizeof(struct lksearch_t));
+    lk->inst = inst;
+    lk->c = inst->cands;
+    lk->t = tour_from_succ(succ, nnodes);
+
+    /* don't look bits queue, as in the neighbor 2opt */
+    int* queue = (int*)malloc(nnodes * sizeof(int));
+    char* inqueue = (char*)calloc(nnodes, sizeof(char));
+    int head = 0, tail = 0, size = 0;
+    for (int i = 0, v = 0; i < nnodes; i++, v = tour_next(lk->t, v)) {
+        queue[tail] = v;
+        tail = (tail + 1) % nnodes;
+        inqueue[v] = 1;
+        size++;
+    }
+
+    while (size > 0 && stopwatch(s, e) / 1000.0 < inst->params->timelimit) {
+        int t1 = queue[head];
+        head = (head + 1) % nnodes;
+        inqueue[t1] = 0;
+        size--;
+
+        double delta = lk_move(lk, t1);
+        if (delta > -EPSILON) continue;
+
+        improvement += delta;
+
+        /* every endpoint of the kept flips looks again */
+        for (int i = 0; i < 4 * lk->depth; i++) {
+            int v = lk->flips[i];
+            if (inqueue[v]) continue;
+
+            queue[tail] = v;
+            tail = (tail + 1) % nnodes;
+            inqueue[v] = 1;
+            size++;
+        }
+    }
+
+    tour_to_succ(lk->t, succ);
+
+    tour_free(lk->t);
+    free(lk);
+    free(queue);
+    free(inqueue);
+
+    return improvement;
+}
+
+double lk_move(lksearch lk, int t1) {
+    /* variable depth search from both tour edges of t1: the chain of flips
+     * is cut back to its best closed tour, kept only if it improves */
+    instance inst = lk->inst;
+
+    for (int dir = 0; dir < 2; dir++) {
+        int t2 = dir == 0 ? tour_next(lk->t, t1) : tour_prev(lk->t, t1);
+
+        lk->t1 = t1;
+        lk->depth = 0;
+        lk->removed[0] = t1;
+        lk->removed[1] = t2;
+        lk->best = 0.0;
+        lk->bestdepth = 0;
+
+        lk_step(lk, t2, dist(t1, t2, inst));
+
+        if (lk->best > EPSILON) {
+            while (lk->depth > lk->bestdepth) lk_undo(lk);
+
+            if (EXTRA_VERBOSE) {
+                printf("[VERBOSE] lk move from %d depth %d delta %lf\n", t1,
+                       lk->depth, -lk->best);
+            }
+
+            return -lk->best;
+        }
+        assert(lk->depth == 0);
+    }
+
+    return 0.0;
+}
+
+void lk_step(lksearch lk, int t2, double g) {
+    instance inst = lk->inst;
+    tour t = lk->t;
+    int t1 = lk->t1;
+
+    /* backtracking on the first two levels only */
+    int breadth = 1;
+    if (lk->depth == 0) breadth = LK_BREADTH1;
+    if (lk->depth == 1) breadth = LK_BREADTH2;
+
+    /* t4 is on the side of t3 that keeps (t1, t4) closing a tour */
+    int forward = tour_next(t, t2) == t1;
+    int t2next = tour_next(t, t2), t2prev = tour_prev(t, t2);
+
+    /* alternatives sorted by d(t3, t4) - d(t2, t3), largest first */
+    int alt3[LK_BREADTH1], alt4[LK_BREADTH1];
+    double altw[LK_BREADTH1];
+    int nalt = 0;
+
+    int* list = candidates_list(lk->c, t2);
+    int ncands = candidates_size(lk->c, t2);
+    for (int k = 0; k < ncands; k++) {
+        int t3 = list[k];
+        double d23 = dist(t2, t3, inst);
+
+        /* the partial gain must stay positive */
+        if (g - d23 <= EPSILON) break;
+        if (t3 == t1 || t3 == t2next || t3 == t2prev) continue;
+
+        int t4 = forward ? tour_next(t, t3) : tour_prev(t, t3);
+
+        /* added edges are never removed and removed ones never added */
+        if (lk_isremoved(lk, t2, t3) || lk_isadded(lk, t3, t4)) continue;
+
+        double w = dist(t3, t4, inst) - d23;
+        if (nalt == breadth && w <= altw[nalt - 1]) continue;
+
+        int i = nalt < breadth ? nalt++ : breadth - 1;
+        for (; i > 0 && altw[i - 1] < w; i--) {
+            alt3[i] = alt3[i - 1];
+            alt4[i] = alt4[i - 1];
+            altw[i] = altw[i - 1];
+        }
+        alt3[i] = t3;
+        alt4[i] = t4;
+        altw[i] = w;
+    }
+
+    for (int i = 0; i < nalt; i++) {
+        int t3 = alt3[i], t4 = alt4[i];
+
+        /* (t2, t1), (t3, t4) becomes (t2, t3), (t1, t4) */
+        tour_make2opt(t, t2, t1, t3, t4);
+
+        int d = lk->depth;
+        lk->flips[4 * d] = t2;
+        lk->flips[4 * d + 1] = t1;
+        lk->flips[4 * d + 2] = t3;
+        lk->flips[4 * d + 3] = t4;
+        lk->added[2 * d] = t2;
+        lk->added[2 * d + 1] = t3;
+        lk->removed[2 * (d + 1)] = t3;
+        lk->removed[2 * (d + 1) + 1] = t4;
+        lk->depth++;
+
+        double gi = g - dist(t2, t3, inst) + dist(t3, t4, inst);
+        double closed = gi - dist(t4, t1, inst);
+        if (closed > lk->best) {
+            lk->best = closed;
+            lk->bestdepth = lk->depth;
+        }
+
+        if (lk->depth < LK_MAXDEPTH) lk_step(lk, t4, gi);
+
+        /* improving chain found: the caller cuts it back */
+        if (lk->best > EPSILON) return;
+
+        lk_undo(lk);
+    }
+}
+
+void lk_undo(lksearch lk) {
+    assert(lk->depth > 0);
+
+    lk->depth--;
+    int* f = lk->flips + 4 * lk->depth;
+
+    /* (t2, t3), (t1, t4) becomes (t2, t1), (t3, t4) again */
+    tour_make2opt(lk->t, f[0], f[2], f[1], f[3]);
+}
+
+int lk_isadded(lksearch lk, int u, int v) {
+    for (int i = 0; i < lk->depth; i++) {
+        int a = lk->added[2 * i], b = lk->added[2 * i + 1];
+        if ((a == u && b == v) || (a == v && b == u)) return 1;
+    }
+    return 0;
+}
+
+int lk_isremoved(lksearch lk, int u, int v) {
+    for (int i = 0; i <= lk->depth; i++) {
+        int a = lk->removed[2 * i], b = lk->removed[2 * i + 1];
+        if ((a == u && b == v) || (a == v && b == u)) return 1;
+    }
+    return 0;
+}
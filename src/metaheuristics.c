@@ -2,23 +2,50 @@
 
 #include <assert.h>
 #include <float.h>
+#include <math.h>
+#include <omp.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "../include/candidates.h"
 #include "../include/constructives.h"
 #include "../include/globals.h"
 #include "../include/refinements.h"
 #include "../include/utils.h"
 
-solution child(instance inst, solution parent1, solution parent2);
-solution TSPrandom(instance inst);
+/* genetic helpers */
+void genetic_child(genetic ga, instance inst, int p1, int p2, int c);
+void genetic_eax(genetic ga, instance inst, int p1, int p2, int c);
+int eax_abcycles(genetic ga, int* succ1, int* succ2);
+void eax_relink(int* link, int u, int from, int to);
+int eax_subtours(genetic ga);
+void eax_merge(genetic ga, instance inst, int ncomps);
+int genetic_mutate(genetic ga, instance inst, int id, struct timespec* s,
+                   struct timespec* e);
+void genetic_populate(genetic ga, instance inst);
+int genetic_generation(genetic ga, instance inst, struct timespec* s,
+                       struct timespec* e);
+void genetic_rank(genetic ga);
+void genetic_migrate(genetic ga, int island, int nislands, int* migrants,
+                     double* migrantz);
+void genetic_champion(genetic ga, instance inst, solution sol, int* succ,
+                      struct timespec* s, struct timespec* e);
+
+/* neighbor lists tabu search helpers */
+solution TSPtabusearch_neighbor(instance inst, int* succ);
+void tabu_moves_neighbors(tabu_moves tm, tour t, int v);
+void tabu_moves_compute(tabu_moves tm, instance inst, int slot, int i);
+int tabu_edge_istabu(int* tabu_to, int* tabu_since, int tenure, int k, int u,
+                     int v);
+void tabu_edge_add(int* tabu_to, int* tabu_since, int k, int u, int v);
 
 solution TSPvns(instance inst, int* succ) {
     assert(inst != NULL);
 
     int nnodes = inst->nnodes;
-    srand(time(NULL));
-    unsigned int seedp = time(NULL);
+    rng r;
+    rng_seed(&r, inst->params->randomseed, 0);
 
     /* track the best solution up to this point */
     solution sol = create_solution(inst, VNS_RANDOM, nnodes);
@@ -28,7 +55,7 @@ solution TSPvns(instance inst, int* succ) {
     /* if no successor array passed, create a random solution */
     int succ_tofree = 0;
     if (succ == NULL) {
-        succ = randomtour(nnodes, seedp);
+        succ = randomtour(nnodes, &r);
         succ_tofree = 1;
     }
 
@@ -39,32 +66,51 @@ solution TSPvns(instance inst, int* succ) {
 
     /* start the iteration! */
     int k = VNS_K_START;
-    int first_iter = 1;
+    int kicked[4 * VNS_K_MAX];
+
+    /* first local optimum from the whole tour */
+    double obj = 0.0;
+    for (int i = 0; i < nnodes; i++) obj += dist(i, succ[i], inst);
+    obj += refine(inst, succ, nnodes, &s, &e);
+
+    /* store it now: the refinement may have used up the time limit */
+    for (int i = 0; i < nnodes; i++) sol->edges[i] = (edge){i, succ[i]};
+    sol->zstar = obj;
+    tracker_add(sol->t, stopwatch(&s, &e), sol->zstar);
+
+    /* kicks and repairs on a tour kept across the iterations */
+    localsearch ls = localsearch_create(inst, succ);
+
     while (stopwatch(&s, &e) / 1000.0 < inst->params->timelimit &&
            k < VNS_K_MAX) {
         if (EXTRA_VERBOSE) printf("[VERBOSE] kick size: %d\n", k);
 
-        /* perturbe solution temp solution */
-        if (!first_iter)
-            kick(succ, nnodes, k);
-        else
-            first_iter = 0;
-
-        double obj = 0.0;
-        for (int i = 0; i < nnodes; i++) obj += dist(i, succ[i], inst);
+        /* perturbe solution, the objective changes on the cut edges */
+        kick(ls->t, k, &r, kicked);
+        for (int i = 0; i < k; i++) {
+            int* removed = kicked + 2 * i;
+            int* added = kicked + 2 * (k + i);
+            obj += dist(added[0], added[1], inst) -
+                   dist(removed[0], removed[1], inst);
+        }
 
-        if (EXTRA_VERBOSE) printf("[VERBOSE] kicked objective: %lf\n", obj);
+        if (EXTRA_VERBOSE) {
+            printf("[VERBOSE] kicked objective: %lf\n", obj);
+        }
 
-        /* find local optimum */
-        obj += twoopt_refinement(inst, succ, nnodes, &s, &e);
-        /* obj += threeopt_refinement(inst, succ, nnodes); */
+        /* find local optimum: the rest of the tour already is one, look
+         * only around the endpoints of the cut edges */
+        obj += refine_from(ls, kicked, 2 * k, &s, &e);
 
         if (EXTRA_VERBOSE) printf("[VERBOSE] refined objective: %lf\n", obj);
 
-        if (obj < sol->zstar) {
-            /* store the succ as usual edges array */
+        if (obj < sol->zstar - EPSILON) {
+            /* store the succ as usual edges array, resync the objective */
+            tour_to_succ(ls->t, succ);
+            obj = 0.0;
             for (int i = 0; i < nnodes; i++) {
                 sol->edges[i] = (edge){i, succ[i]};
+                obj += dist(i, succ[i], inst);
             }
 
             if (EXTRA_VERBOSE) {
@@ -85,6 +131,7 @@ solution TSPvns(instance inst, int* succ) {
             k += VNS_K_STEP;
         }
     }
+    localsearch_free(ls);
     if (succ_tofree) free(succ);
 
     return sol;
@@ -93,9 +140,14 @@ solution TSPvns(instance inst, int* succ) {
 solution TSPtabusearch(instance inst, int* succ) {
     assert(inst != NULL);
 
+    /* the neighbor lists engine scans O(n) moves instead of O(n^2) */
+    if (inst->params->neighbor_lists) {
+        return TSPtabusearch_neighbor(inst, succ);
+    }
+
     int nnodes = inst->nnodes;
-    srand(time(NULL));
-    unsigned int seedp = time(NULL);
+    rng r;
+    rng_seed(&r, inst->params->randomseed, 0);
 
     /* track the best solution up to this point */
     solution sol = create_solution(inst, TABU_SEACH_RANDOM, nnodes);
@@ -111,7 +163,7 @@ solution TSPtabusearch(instance inst, int* succ) {
     /* if no successor array passed, create a random solution */
     int succ_tofree = 0;
     if (succ == NULL) {
-        succ = randomtour(nnodes, seedp);
+        succ = randomtour(nnodes, &r);
         succ_tofree = 1;
     }
 
@@ -124,16 +176,30 @@ solution TSPtabusearch(instance inst, int* succ) {
     double obj = 0.0;
     for (int i = 0; i < nnodes; i++) obj += dist(i, succ[i], inst);
 
+    /* best non tabu move of each row, updated after every move */
+    twoopt_cache tc = twoopt_cache_create(inst, succ, 1);
+    char* allowed = (char*)malloc(nnodes * sizeof(char));
+
     /* start the iterations! */
     int k = 0; /* iteration counter */
     while (stopwatch(&s, &e) / 1000.0 < inst->params->timelimit) {
+        for (int i = 0; i < nnodes; i++) {
+            allowed[i] = k > tabu_nodes[i] + tenure;
+        }
+        twoopt_cache_allow(tc, inst, succ, allowed);
+
         int a, b;
-        double delta =
-            twoopt_tabu_pick(inst, succ, tabu_nodes, tenure, k, &a, &b);
+        double delta = twoopt_cache_pick(tc, &a, &b);
         if (EXTRA_VERBOSE) {
             printf("[VERBOSE] iteration %d: delta %lf\n", k, delta);
         }
 
+        /* every move is tabu: let the tenures expire */
+        if (isinf(delta)) {
+            k++;
+            continue;
+        }
+
         if (delta > EPSILON && downhill) {
             /* local optimum, save */
             if (obj < sol->zstar) {
@@ -159,7 +225,7 @@ solution TSPtabusearch(instance inst, int* succ) {
         if (delta < -EPSILON) downhill = 1;
 
         /* actually perform the move, even if delta positive */
-        twoopt_move(succ, nnodes, a, b);
+        twoopt_cache_move(tc, inst, succ, a, b);
         /* update the objective */
         obj += delta;
 
@@ -209,177 +275,675 @@ solution TSPtabusearch(instance inst, int* succ) {
 
     if (succ_tofree) free(succ);
     free(tabu_nodes);
+    free(allowed);
+    twoopt_cache_free(tc);
 
     return sol;
 }
 
-solution TSPgenetic(instance inst) {
+solution TSPtabusearch_neighbor(instance inst, int* succ) {
     assert(inst != NULL);
-    if (EXTRA_VERBOSE) {
-        printf("[VERBOSE] Solving using genetic algorithm!\n");
-    }
 
-    srand(time(NULL));
+    int nnodes = inst->nnodes;
+    rng r;
+    rng_seed(&r, inst->params->randomseed, 0);
 
-    /* initialize total wall-clock time of execution time */
+    /* track the best solution up to this point */
+    solution sol = create_solution(inst, TABU_SEACH_RANDOM, nnodes);
+    sol->distance_time = 0.0;
+    sol->zstar = DBL_MAX;
+
+    /* if no successor array passed, create a random solution */
+    int succ_tofree = 0;
+    if (succ == NULL) {
+        succ = randomtour(nnodes, &r);
+        succ_tofree = 1;
+    }
+
+    /* initialize total wall-clock time */
     struct timespec s, e;
     s.tv_sec = e.tv_sec = -1;
     stopwatch(&s, &e);
 
-    int nnodes = inst->nnodes;
-    solution sol = create_solution(inst, GENETIC, nnodes);
-    sol->zstar = DBL_MAX;
-    solution champion;
-
-    solution* population = (solution*)calloc(GENETIC_N, sizeof(solution));
-    solution* offspring = (solution*)calloc(GENETIC_K, sizeof(solution));
+    /* compute obj: it will be updated throught iterations */
+    double obj = 0.0;
+    for (int i = 0; i < nnodes; i++) obj += dist(i, succ[i], inst);
 
-    /* generate initial populaiton */
-    for (int i = 0; i < GENETIC_N; i++) {
-        if ((double)rand() / (double)RAND_MAX < GENETIC_PERC_LUCKYCHILDREN) {
-            population[i] = TSPgrasp(inst, 1);
-            population[i]->model_type = GENETIC;
-        } else {
-            population[i] = TSPrandom(inst);
-        }
+    /* the -R refinement reaches the first local optimum much faster than the
+     * downhill tabu moves. Not the O(n^2) twoopt one: on big instances it
+     * eats the whole time limit between two checks, the candidate lists
+     * one is used instead */
+    if (inst->params->refinement_type == TWOOPT_REFINEMENT) {
+        obj += twoopt_neighbor_refinement(inst, succ, nnodes, &s, &e);
+    } else {
+        obj += refine(inst, succ, nnodes, &s, &e);
     }
-    if (VERBOSE) printf("[VERBOSE] done generating population\n");
 
-    /* update timelimit */
-    double timelimit = inst->params->timelimit;
-    inst->params->timelimit = timelimit *= GENETIC_PERC_TIME;
+    build_candidates(inst);
+    tour t = tour_from_succ(succ, nnodes);
+    tabu_moves tm = tabu_moves_create(inst, t);
+
+    /* tabu attributes are the removed edges: adding one back is tabu. Every
+     * node remembers its last TS_EDGE_SLOTS lost edges and when */
+    int* tabu_to = (int*)malloc(TS_EDGE_SLOTS * nnodes * sizeof(int));
+    int* tabu_since = (int*)malloc(TS_EDGE_SLOTS * nnodes * sizeof(int));
+    intset(tabu_to, -1, TS_EDGE_SLOTS * nnodes);
+    intset(tabu_since, -INF, TS_EDGE_SLOTS * nnodes);
+    int tenure = TS_MAX_TENURE;
+    int diversification = 1;
+    int downhill = 1;
+
+    /* best objective seen, saved or not */
+    double best = obj;
+
+    /* start the iterations! */
+    int k = 0; /* iteration counter */
     while (stopwatch(&s, &e) / 1000.0 < inst->params->timelimit) {
-        /* pick randomly two parents */
-        for (int i = 0; i < GENETIC_K; i++) {
-            int parent1_idx, parent2_idx;
+        /* aspiration: a tabu move is taken if it beats the best tour */
+        int a, an, b, bn;
+        double delta =
+            tabu_moves_pick(tm, inst, t, tabu_to, tabu_since, tenure, k,
+                            best - obj, &a, &an, &b, &bn);
+        if (EXTRA_VERBOSE) {
+            printf("[VERBOSE] iteration %d: delta %lf\n", k, delta);
+        }
+
+        /* every move is tabu: let the tenures expire */
+        if (isinf(delta)) {
+            k++;
+            continue;
+        }
+
+        if (delta > EPSILON && downhill) {
+            /* local optimum, save */
+            if (obj < sol->zstar) {
+                tour_to_succ(t, succ);
+                for (int i = 0; i < nnodes; i++) {
+                    sol->edges[i] = (edge){i, succ[i]};
+                }
 
-            parent1_idx = rand() % GENETIC_N;
-            parent2_idx = rand() % GENETIC_N;
-            while (parent2_idx == parent1_idx) parent2_idx = rand() % GENETIC_N;
+                if (EXTRA_VERBOSE) {
+                    printf(
+                        "[VERBOSE] Improved solution! last opt: %lf -> new "
+                        "opt: %lf\n",
+                        sol->zstar, obj);
+                }
+                sol->zstar = obj;
+
+                tracker_add(sol->t, stopwatch(&s, &e), sol->zstar);
+            }
 
-            offspring[i] =
-                child(inst, population[parent1_idx], population[parent2_idx]);
+            downhill = 0;
         }
-        if (stopwatch(&s, &e) / 1000.0 > inst->params->timelimit) {
-            break;
+        if (delta < -EPSILON) downhill = 1;
+
+        /* (a, an), (b, bn) becomes (a, b), (an, bn), even if delta positive */
+        tour_make2opt(t, a, an, b, bn);
+        obj += delta;
+        if (obj < best) best = obj;
+
+        int touched[4] = {a, an, b, bn};
+        tabu_moves_update(tm, inst, t, touched, 4);
+
+        tabu_edge_add(tabu_to, tabu_since, k, a, an);
+        tabu_edge_add(tabu_to, tabu_since, k, b, bn);
+
+        k++;
+
+        if ((k + 1) % TS_PHASEDURATION == 0) {
+            diversification = (diversification + 1) % 2;
+
+            if (diversification)
+                tenure = TS_MIN_TENURE;
+            else
+                tenure = TS_MAX_TENURE;
+
+            if (VERBOSE) {
+                printf(
+                    "[VERBOSE] iteration %d, diversification = %d, tenure %d\n",
+                    k, diversification, tenure);
+            }
         }
-        if (VERBOSE) printf("[VERBOSE] done generating children\n");
+    }
 
-        /* insert randomly the offspring in the population and kill parents but
-         * keep the best ones*/
-        int* best_sols = (int*)calloc(GENETIC_N, sizeof(int));
-        pair* objs = (pair*)calloc(GENETIC_N, sizeof(pair));
-        for (int i = 0; i < GENETIC_N; i++) {
-            objs[i] = (pair){population[i]->zstar, i};
+    /* maybe last donwhill was the best one, save here! */
+    if (obj < sol->zstar) {
+        tour_to_succ(t, succ);
+        for (int i = 0; i < nnodes; i++) {
+            sol->edges[i] = (edge){i, succ[i]};
         }
-        qsort(objs, GENETIC_N, sizeof(pair), paircmp);
+        sol->zstar = obj;
+
+        tracker_add(sol->t, stopwatch(&s, &e), sol->zstar);
+    }
+
+    if (succ_tofree) free(succ);
+    tabu_moves_free(tm);
+    tour_free(t);
+    free(tabu_to);
+    free(tabu_since);
+
+    return sol;
+}
+
+tabu_moves tabu_moves_create(instance inst, tour t) {
+    candidates c = inst->cands;
+    assert(c != NULL);
 
-        for (int i = 0; i < GENETIC_NBESTSOLS; i++) {
-            best_sols[objs[i].x] = 1;
+    int nnodes = inst->nnodes;
+    int nslots = c->start[nnodes];
+
+    tabu_moves tm = (tabu_moves)calloc(1, sizeof(struct tabu_moves_t));
+    tm->nnodes = nnodes;
+    tm->c = c;
+
+    /* reverse lists: the slots where each node appears as a candidate */
+    tm->rstart = (int*)calloc(nnodes + 1, sizeof(int));
+    tm->rslot = (int*)malloc(nslots * sizeof(int));
+    for (int p = 0; p < nslots; p++) tm->rstart[c->neigh[p] + 1]++;
+    for (int i = 0; i < nnodes; i++) tm->rstart[i + 1] += tm->rstart[i];
+
+    tm->row = (int*)malloc(nslots * sizeof(int));
+    int* fill = (int*)malloc(nnodes * sizeof(int));
+    for (int i = 0; i < nnodes; i++) fill[i] = tm->rstart[i];
+    for (int i = 0; i < nnodes; i++) {
+        for (int p = c->start[i]; p < c->start[i + 1]; p++) {
+            tm->rslot[fill[c->neigh[p]]++] = p;
+            tm->row[p] = i;
         }
+    }
+    free(fill);
 
-        for (int i = 0; i < GENETIC_K; i++) {
-            int parent = rand() % GENETIC_N;
-            while (best_sols[parent]) parent = rand() % GENETIC_N;
+    tm->nbr = (int*)malloc(2 * nnodes * sizeof(int));
+    for (int v = 0; v < nnodes; v++) tabu_moves_neighbors(tm, t, v);
 
-            free_solution(population[parent]);
-            population[parent] = offspring[i];
+    tm->delta = (double*)malloc(4 * nslots * sizeof(double));
+#pragma omp parallel for num_threads(heuristic_threads(inst))
+    for (int i = 0; i < nnodes; i++) {
+        for (int p = c->start[i]; p < c->start[i + 1]; p++) {
+            tabu_moves_compute(tm, inst, p, i);
         }
-        if (VERBOSE) printf("[VERBOSE] done killing\n");
+    }
 
-        /* mutate the population */
-        int timelimit_reached = 0;
-        for (int i = 0; i < GENETIC_NMUTATIONS; i++) {
-            if (timelimit_reached) break;
+    tm->orient = (char*)malloc(nnodes * sizeof(char));
 
-            int tomutate = rand() % GENETIC_N;
-            int* succ;
-            if ((succ = edges_tosucc(population[tomutate]->edges, nnodes)) ==
-                NULL) {
-                print_error("no solution found!");
-            }
+    return tm;
+}
 
-            for (int j = 0; j < GENETIC_NMOVES; j++) {
-                int a, b;
-                double delta;
-                a = b = 0;
+void tabu_moves_free(tabu_moves tm) {
+    if (tm == NULL) return;
 
-                delta = twoopt_pick(inst, succ, &a, &b);
-                if (stopwatch(&s, &e) / 1000.0 > inst->params->timelimit) {
-                    timelimit_reached = 1;
-                    break;
-                }
-                if (delta == 0.0) break; /* no more moves possible */
+    free(tm->row);
+    free(tm->nbr);
+    free(tm->rstart);
+    free(tm->rslot);
+    free(tm->delta);
+    free(tm->orient);
 
-                if (EXTRA_VERBOSE) {
-                    printf("[VERBOSE] refinement on %d, %d delta %lf\n", a, b,
-                           delta);
-                }
+    free(tm);
+}
 
-                /* actually perform the move */
-                twoopt_move(succ, nnodes, a, b);
-                /* update the objective */
-                population[tomutate]->zstar += delta;
-            }
+void tabu_moves_neighbors(tabu_moves tm, tour t, int v) {
+    /* the tour neighbors are told apart by their index, not by the
+     * orientation, which the moves change everywhere */
+    int vn = tour_next(t, v), vp = tour_prev(t, v);
 
-            for (int i = 0; i < nnodes; i++) {
-                population[tomutate]->edges[i] = (edge){i, succ[i]};
-            }
+    tm->nbr[2 * v] = mini(vn, vp);
+    tm->nbr[2 * v + 1] = maxi(vn, vp);
+}
+
+void tabu_moves_compute(tabu_moves tm, instance inst, int slot, int i) {
+    /* the 4 ways of removing a tour edge of i and one of j to add (i, j) */
+    int j = tm->c->neigh[slot];
+    int* x = tm->nbr + 2 * i;
+    int* y = tm->nbr + 2 * j;
+
+    int adjacent = j == x[0] || j == x[1];
+    double dij = dist(i, j, inst);
+    for (int m = 0; m < 4; m++) {
+        int xm = x[m / 2], ym = y[m % 2];
 
-            free(succ);
+        if (adjacent || xm == ym) {
+            tm->delta[4 * slot + m] = INFINITY;
+            continue;
         }
-        if (VERBOSE) printf("[VERBOSE] done mutating\n");
 
-        /* track champion */
-        double best_zstar = DBL_MAX;
-        for (int i = 0; i < GENETIC_N; i++) {
-            if (population[i]->zstar < best_zstar) {
-                best_zstar = population[i]->zstar;
+        tm->delta[4 * slot + m] = dij + dist(xm, ym, inst) -
+                                  (dist(i, xm, inst) + dist(j, ym, inst));
+    }
+}
+
+void tabu_moves_update(tabu_moves tm, instance inst, tour t, int* touched,
+                       int ntouched) {
+    /* moves with a touched node as i or as j: their tour neighbors changed */
+    candidates c = tm->c;
+
+    for (int h = 0; h < ntouched; h++) tabu_moves_neighbors(tm, t, touched[h]);
+
+    for (int h = 0; h < ntouched; h++) {
+        int v = touched[h];
+
+        for (int p = c->start[v]; p < c->start[v + 1]; p++) {
+            tabu_moves_compute(tm, inst, p, v);
+        }
+        for (int r = tm->rstart[v]; r < tm->rstart[v + 1]; r++) {
+            int p = tm->rslot[r];
+            tabu_moves_compute(tm, inst, p, tm->row[p]);
+        }
+    }
+}
+
+double tabu_moves_pick(tabu_moves tm, instance inst, tour t, int* tabu_to,
+                       int* tabu_since, int tenure, int k, double aspiration,
+                       int* a, int* an, int* b, int* bn) {
+    /* best 2opt move adding an edge (i, j) of the candidate lists, even if
+     * worsening. Moves adding a tabu edge only if delta < aspiration */
+    candidates c = tm->c;
+    int nnodes = tm->nnodes;
+
+    /* orient[v]: the successor of v is its smaller index tour neighbor.
+     * The two removed edges point the same way, so the valid moves of a
+     * slot are m = 0, 3 if i and j agree, m = 1, 2 otherwise */
+#pragma omp parallel for num_threads(heuristic_threads(inst))
+    for (int v = 0; v < nnodes; v++) {
+        tm->orient[v] = tour_next(t, v) == tm->nbr[2 * v];
+    }
+
+    double deltabest = INFINITY;
+    int slotbest = -1, mbest = -1;
 
-                champion = population[i];
+    const int* start = c->start;
+    const int* neigh = c->neigh;
+    const char* orient = tm->orient;
+    const double* deltas = tm->delta;
+
+#pragma omp parallel num_threads(heuristic_threads(inst))
+    {
+        double tbest = INFINITY;
+        int tslot = -1, tm_ = -1;
+
+#pragma omp for schedule(dynamic, 64) nowait
+        for (int i = 0; i < nnodes; i++) {
+            for (int p = start[i]; p < start[i + 1]; p++) {
+                int j = neigh[p];
+
+                /* no branch on the orientation: one test per slot */
+                int agree = orient[i] == orient[j];
+                double d0 = deltas[4 * p + !agree];
+                double d1 = deltas[4 * p + 2 + agree];
+                if ((d0 < d1 ? d0 : d1) >= tbest) continue;
+
+                for (int h = 0; h < 2; h++) {
+                    int m = h == 0 ? !agree : 2 + agree;
+                    double delta = deltas[4 * p + m];
+                    if (delta >= tbest) continue;
+
+                    if (delta >= aspiration - EPSILON) {
+                        int x = tm->nbr[2 * i + m / 2];
+                        int y = tm->nbr[2 * j + m % 2];
+
+                        if (tabu_edge_istabu(tabu_to, tabu_since, tenure, k,
+                                             i, j) ||
+                            tabu_edge_istabu(tabu_to, tabu_since, tenure, k,
+                                             x, y)) {
+                            continue;
+                        }
+                    }
+
+                    tbest = delta;
+                    tslot = p;
+                    tm_ = m;
+                }
             }
         }
 
-        if (VERBOSE) {
-            printf("[VERBOSE] champion zstar: %lf\n", champion->zstar);
+        /* ties go to the smallest slot, as in the sequential scan */
+#pragma omp critical
+        if (tbest < deltabest || (tbest == deltabest && tslot < slotbest)) {
+            deltabest = tbest;
+            slotbest = tslot;
+            mbest = tm_;
         }
+    }
 
-        if (champion->zstar < sol->zstar) {
-            sol->zstar = champion->zstar;
-            tracker_add(sol->t, stopwatch(&s, &e), sol->zstar);
+    *a = *an = *b = *bn = -1;
+    if (slotbest < 0) return deltabest;
+
+    *a = tm->row[slotbest];
+    *an = tm->nbr[2 * *a + mbest / 2];
+    *b = c->neigh[slotbest];
+    *bn = tm->nbr[2 * *b + mbest % 2];
+
+    return deltabest;
+}
+
+int tabu_edge_istabu(int* tabu_to, int* tabu_since, int tenure, int k, int u,
+                     int v) {
+    for (int h = 0; h < TS_EDGE_SLOTS; h++) {
+        if (tabu_to[TS_EDGE_SLOTS * u + h] == v &&
+            k <= tabu_since[TS_EDGE_SLOTS * u + h] + tenure) {
+            return 1;
+        }
+        if (tabu_to[TS_EDGE_SLOTS * v + h] == u &&
+            k <= tabu_since[TS_EDGE_SLOTS * v + h] + tenure) {
+            return 1;
         }
     }
 
-    /* last champion becames the solution returned */
-    sol->zstar = champion->zstar;
-    for (int i = 0; i < nnodes; i++) {
-        sol->edges[i] = (edge){champion->edges[i].i, champion->edges[i].j};
+    return 0;
+}
+
+void tabu_edge_add(int* tabu_to, int* tabu_since, int k, int u, int v) {
+    /* the oldest slot of u is overwritten */
+    int oldest = 0;
+    for (int h = 1; h < TS_EDGE_SLOTS; h++) {
+        if (tabu_since[TS_EDGE_SLOTS * u + h] <
+            tabu_since[TS_EDGE_SLOTS * u + oldest]) {
+            oldest = h;
+        }
     }
 
-    /* refine best solution if we have time! */
-    int* succ = (int*)calloc(nnodes, sizeof(int));
-    if ((succ = edges_tosucc(sol->edges, nnodes)) == NULL) {
-        print_error("solver didnt produced a tour");
+    tabu_to[TS_EDGE_SLOTS * u + oldest] = v;
+    tabu_since[TS_EDGE_SLOTS * u + oldest] = k;
+}
+
+solution TSPgenetic(instance inst) {
+    assert(inst != NULL);
+    if (EXTRA_VERBOSE) {
+        printf("[VERBOSE] Solving using genetic algorithm!\n");
+    }
+
+    /* initialize total wall-clock time of execution time */
+    struct timespec s, e;
+    s.tv_sec = e.tv_sec = -1;
+    stopwatch(&s, &e);
+
+    int nnodes = inst->nnodes;
+    solution sol = create_solution(inst, GENETIC, nnodes);
+    sol->zstar = DBL_MAX;
+    if (inst->params->crossover_type == EAX_CROSSOVER ||
+        inst->params->neighbor_lists) {
+        build_candidates(inst);
     }
 
-    /* reset times */
+    /* one island per thread, sharing the population: the best individuals
+     * of each island travel to the next one along the ring */
+    int nislands = heuristic_threads(inst);
+    int npop = GENETIC_N / nislands;
+    if (npop < GENETIC_MIN_ISLAND) npop = GENETIC_MIN_ISLAND;
+
+    int nmigrants = nislands * GENETIC_NMIGRANTS;
+    int* migrants = (int*)malloc((size_t)nmigrants * nnodes * sizeof(int));
+    double* migrantz = (double*)malloc(nmigrants * sizeof(double));
+    for (int i = 0; i < nmigrants; i++) migrantz[i] = DBL_MAX;
+
+    /* successors of the champion among all the islands */
+    int* succ = (int*)malloc(nnodes * sizeof(int));
+
+    /* update timelimit */
+    double timelimit = inst->params->timelimit;
+    inst->params->timelimit = timelimit * GENETIC_PERC_TIME;
+
+#pragma omp parallel num_threads(nislands)
+    {
+        int island = omp_get_thread_num();
+        struct timespec ts = s, te = e;
+
+        /* every tour of the island lives in its arena */
+        genetic ga = genetic_create(inst, npop, island);
+        genetic_populate(ga, inst);
+        genetic_champion(ga, inst, sol, succ, &ts, &te);
+        if (VERBOSE) printf("[VERBOSE] done generating population\n");
+
+        int generation = 0;
+        while (stopwatch(&ts, &te) / 1000.0 < inst->params->timelimit) {
+            if (genetic_generation(ga, inst, &ts, &te)) break;
+
+            if (++generation % GENETIC_MIGRATION_GAP == 0 && nislands > 1) {
+                genetic_migrate(ga, island, nislands, migrants, migrantz);
+            }
+
+            genetic_champion(ga, inst, sol, succ, &ts, &te);
+        }
+
+        genetic_free(ga);
+    }
+
+    /* refine best solution if we have time! */
     inst->params->timelimit = timelimit * (1 - GENETIC_PERC_TIME);
     s.tv_sec = e.tv_sec = -1;
     stopwatch(&s, &e);
 
-    sol->zstar += twoopt_refinement(inst, succ, nnodes, &s, &e);
+    sol->zstar += refine(inst, succ, nnodes, &s, &e);
+    for (int i = 0; i < nnodes; i++) sol->edges[i] = (edge){i, succ[i]};
+
+    free(migrants);
+    free(migrantz);
     free(succ);
 
-    for (int i = 0; i < GENETIC_N; i++) {
-        free_solution(population[i]);
+    return sol;
+}
+
+void genetic_populate(genetic ga, instance inst) {
+    int nnodes = inst->nnodes;
+
+    for (int i = 0; i < ga->npop; i++) {
+        int* succ = ga->succ + (size_t)ga->ids[i] * nnodes;
+
+        if (rng_double(&ga->r) < GENETIC_PERC_LUCKYCHILDREN) {
+            solution lucky = TSPgrasp(inst, 1, &ga->r);
+            int* lsucc;
+            if ((lsucc = edges_tosucc(lucky->edges, nnodes)) == NULL) {
+                print_error("no solution found!");
+            }
+            for (int j = 0; j < nnodes; j++) succ[j] = lsucc[j];
+
+            free(lsucc);
+            free_solution(lucky);
+        } else {
+            /* random permutation, closed in a cycle */
+            int* order = ga->chromosome;
+            for (int j = 0; j < nnodes; j++) order[j] = j;
+            for (int j = nnodes - 1; j > 0; j--) {
+                swap(&order[j], &order[rng_int(&ga->r, j + 1)]);
+            }
+            for (int j = 0; j < nnodes; j++) {
+                succ[order[j]] = order[(j + 1) % nnodes];
+            }
+        }
+
+        ga->zstar[ga->ids[i]] = 0.0;
+        for (int j = 0; j < nnodes; j++) {
+            ga->zstar[ga->ids[i]] += dist(j, succ[j], inst);
+        }
     }
-    free(population);
-    free(offspring);
+}
 
-    return sol;
+int genetic_generation(genetic ga, instance inst, struct timespec* s,
+                       struct timespec* e) {
+    /* one generation of the island: returns 1 if the time limit is reached
+     * before the offspring joins the population */
+    int npop = ga->npop;
+
+    /* pick randomly two parents */
+    for (int i = 0; i < ga->noffspring; i++) {
+        int parent1_idx, parent2_idx;
+
+        parent1_idx = rng_int(&ga->r, npop);
+        parent2_idx = rng_int(&ga->r, npop);
+        while (parent2_idx == parent1_idx) {
+            parent2_idx = rng_int(&ga->r, npop);
+        }
+
+        if (inst->params->crossover_type == EAX_CROSSOVER) {
+            genetic_eax(ga, inst, ga->ids[parent1_idx], ga->ids[parent2_idx],
+                        ga->ids[npop + i]);
+        } else {
+            genetic_child(ga, inst, ga->ids[parent1_idx], ga->ids[parent2_idx],
+                          ga->ids[npop + i]);
+        }
+    }
+    if (stopwatch(s, e) / 1000.0 > inst->params->timelimit) return 1;
+    if (VERBOSE) printf("[VERBOSE] done generating children\n");
+
+    /* insert randomly the offspring in the population and kill parents but
+     * keep the best ones*/
+    genetic_rank(ga);
+    for (int i = 0; i < npop; i++) ga->elite[i] = 0;
+    for (int i = 0; i < npop * GENETIC_NBESTSOLS / GENETIC_N; i++) {
+        ga->elite[ga->objs[i].x] = 1;
+    }
+
+    for (int i = 0; i < ga->noffspring; i++) {
+        int parent = rng_int(&ga->r, npop);
+        while (ga->elite[parent]) parent = rng_int(&ga->r, npop);
+
+        /* the dead parent's slot takes the next offspring */
+        swap(&ga->ids[parent], &ga->ids[npop + i]);
+    }
+    if (VERBOSE) printf("[VERBOSE] done killing\n");
+
+    /* mutate the population */
+    for (int i = 0; i < npop * GENETIC_NMUTATIONS / GENETIC_N; i++) {
+        int tomutate = rng_int(&ga->r, npop);
+
+        if (genetic_mutate(ga, inst, ga->ids[tomutate], s, e)) break;
+    }
+    if (VERBOSE) printf("[VERBOSE] done mutating\n");
+
+    return 0;
+}
+
+void genetic_rank(genetic ga) {
+    /* objs sorted by zstar, x the index in ids */
+    for (int i = 0; i < ga->npop; i++) {
+        ga->objs[i] = (pair){ga->zstar[ga->ids[i]], i};
+    }
+    qsort(ga->objs, ga->npop, sizeof(pair), paircmp);
 }
 
-solution child(instance inst, solution parent1, solution parent2) {
+void genetic_migrate(genetic ga, int island, int nislands, int* migrants,
+                     double* migrantz) {
+    int nnodes = ga->nnodes;
+    int from = (island + nislands - 1) % nislands;
+
+    genetic_rank(ga);
+
+#pragma omp critical(genetic_migration)
+    {
+        /* the best individuals leave a copy in the slot of the island */
+        for (int i = 0; i < GENETIC_NMIGRANTS; i++) {
+            int id = ga->ids[ga->objs[i].x];
+            size_t slot = (size_t)island * GENETIC_NMIGRANTS + i;
+
+            memcpy(migrants + slot * nnodes, ga->succ + (size_t)id * nnodes,
+                   nnodes * sizeof(int));
+            migrantz[slot] = ga->zstar[id];
+        }
+
+        /* the worst ones are replaced by those of the previous island */
+        for (int i = 0; i < GENETIC_NMIGRANTS; i++) {
+            int id = ga->ids[ga->objs[ga->npop - 1 - i].x];
+            size_t slot = (size_t)from * GENETIC_NMIGRANTS + i;
+            if (migrantz[slot] == DBL_MAX) continue;
+
+            memcpy(ga->succ + (size_t)id * nnodes, migrants + slot * nnodes,
+                   nnodes * sizeof(int));
+            ga->zstar[id] = migrantz[slot];
+        }
+    }
+}
+
+void genetic_champion(genetic ga, instance inst, solution sol, int* succ,
+                      struct timespec* s, struct timespec* e) {
+    int nnodes = ga->nnodes;
+
+    /* track champion */
+    int champion = ga->ids[0];
+    for (int i = 1; i < ga->npop; i++) {
+        if (ga->zstar[ga->ids[i]] < ga->zstar[champion]) {
+            champion = ga->ids[i];
+        }
+    }
+
+    if (VERBOSE) {
+        printf("[VERBOSE] champion zstar: %lf\n", ga->zstar[champion]);
+    }
+
+#pragma omp critical(genetic_champion)
+    if (ga->zstar[champion] < sol->zstar) {
+        memcpy(succ, ga->succ + (size_t)champion * nnodes,
+               nnodes * sizeof(int));
+        sol->zstar = ga->zstar[champion];
+        tracker_add(sol->t, stopwatch(s, e), sol->zstar);
+    }
+}
+
+genetic genetic_create(instance inst, int npop, int stream) {
+    int nnodes = inst->nnodes;
+    int noffspring = npop * GENETIC_K / GENETIC_N;
+    if (noffspring < 1) noffspring = 1;
+    int size = npop + noffspring;
+
+    genetic ga = (genetic)calloc(1, sizeof(struct genetic_t));
+    ga->nnodes = nnodes;
+    ga->npop = npop;
+    ga->noffspring = noffspring;
+    ga->size = size;
+    rng_seed(&ga->r, inst->params->randomseed, stream);
+    ga->succ = (int*)malloc((size_t)size * nnodes * sizeof(int));
+    ga->zstar = (double*)calloc(size, sizeof(double));
+    ga->ids = (int*)malloc(size * sizeof(int));
+    for (int i = 0; i < size; i++) ga->ids[i] = i;
+
+    ga->chromosome = (int*)malloc(nnodes * sizeof(int));
+    ga->visited = (char*)malloc(nnodes * sizeof(char));
+    ga->dsucc = (double*)malloc(nnodes * sizeof(double));
+    ga->objs = (pair*)malloc(npop * sizeof(pair));
+    ga->elite = (char*)malloc(npop * sizeof(char));
+
+    if (inst->params->crossover_type == EAX_CROSSOVER) {
+        ga->aedges = (int*)malloc(2 * nnodes * sizeof(int));
+        ga->bedges = (int*)malloc(2 * nnodes * sizeof(int));
+        ga->link = (int*)malloc(2 * nnodes * sizeof(int));
+        ga->cycles = (int*)malloc(2 * nnodes * sizeof(int));
+        ga->cstart = (int*)malloc((nnodes + 1) * sizeof(int));
+        ga->walk = (int*)malloc((2 * nnodes + 1) * sizeof(int));
+        ga->walkpos = (int*)malloc(2 * nnodes * sizeof(int));
+        ga->comp = (int*)malloc(nnodes * sizeof(int));
+        ga->csize = (int*)malloc(nnodes * sizeof(int));
+        ga->cnode = (int*)malloc(nnodes * sizeof(int));
+    }
+
+    return ga;
+}
+
+void genetic_free(genetic ga) {
+    if (ga == NULL) return;
+
+    free(ga->succ);
+    free(ga->zstar);
+    free(ga->ids);
+    free(ga->chromosome);
+    free(ga->visited);
+    free(ga->dsucc);
+    free(ga->objs);
+    free(ga->elite);
+    free(ga->aedges);
+    free(ga->bedges);
+    free(ga->link);
+    free(ga->cycles);
+    free(ga->cstart);
+    free(ga->walk);
+    free(ga->walkpos);
+    free(ga->comp);
+    free(ga->csize);
+    free(ga->cnode);
+
+    free(ga);
+}
+
+void genetic_child(genetic ga, instance inst, int p1, int p2, int c) {
     if (VERBOSE) {
         printf("[VERBOSE] creating children!\n\n");
     }
@@ -387,52 +951,41 @@ solution child(instance inst, solution parent1, solution parent2) {
     int nnodes = inst->nnodes;
     int split = nnodes / 2;
 
-    solution child = create_solution(inst, GENETIC, inst->nnodes);
-
-    int* visited = (int*)calloc(nnodes, sizeof(int));
+    int* succ1 = ga->succ + (size_t)p1 * nnodes;
+    int* succ2 = ga->succ + (size_t)p2 * nnodes;
+    int* child = ga->succ + (size_t)c * nnodes;
 
-    int* chromosome = (int*)calloc(nnodes, sizeof(int));
-    int* succ = (int*)calloc(nnodes, sizeof(int));
-    succ = edges_tosucc(parent1->edges, nnodes);
+    int* chromosome = ga->chromosome;
+    char* visited = ga->visited;
+    for (int i = 0; i < nnodes; i++) visited[i] = 0;
 
     /* nodes included in the solution */
     int visnodes = 0;
 
+    /* first half: the path of parent1 from node 0 */
     chromosome[0] = 0;
     visited[0] = 1;
     visnodes++;
 
     for (int i = 1; i < split; i++) {
-        chromosome[i] = succ[chromosome[i - 1]];
+        chromosome[i] = succ1[chromosome[i - 1]];
         visited[chromosome[i]] = 1;
         visnodes++;
     }
 
-    succ = edges_tosucc(parent2->edges, nnodes);
-
-    int done = 0;
-    // aux skip visited nodes
-    int aux = 0;
-
-    while (!done) {
-        if (visited[split + aux] == 1) {
-            aux++;
-        } else {
-            chromosome[split] = split + aux;
-            visited[chromosome[split]] = 1;
-            aux = 0;
-            visnodes++;
-            done = 1;
-        }
-    }
-
-    aux = 0;
+    /* second half: from the first free node, the order of parent2 */
+    int first = split;
+    while (visited[first]) first = (first + 1) % nnodes;
+    chromosome[split] = first;
+    visited[first] = 1;
+    visnodes++;
 
+    int aux = 0; /* skipped visited nodes */
     for (int i = split + 1; i < nnodes && aux < nnodes - split; i++) {
-        int next = succ[chromosome[i - 1]];
+        int next = succ2[chromosome[i - 1]];
 
         while (visited[next] == 1) {
-            next = succ[next];
+            next = succ2[next];
             aux++;
         }
 
@@ -441,11 +994,11 @@ solution child(instance inst, solution parent1, solution parent2) {
         visnodes++;
     }
 
-    // chromosome contains a <nnodes cycle to be completed with extr mileage
+    /* chromosome contains a <nnodes cycle to be completed with extr mileage */
+    ga->zstar[c] = 0.0;
     for (int i = 0; i < visnodes; i++) {
-        child->edges[i] = (edge){chromosome[i], chromosome[(i + 1) % visnodes]};
-        child->zstar +=
-            dist(chromosome[i], chromosome[(i + 1) % visnodes], inst);
+        child[chromosome[i]] = chromosome[(i + 1) % visnodes];
+        ga->zstar[c] += dist(chromosome[i], child[chromosome[i]], inst);
     }
 
     /* extramileage */
@@ -453,102 +1006,296 @@ solution child(instance inst, solution parent1, solution parent2) {
     while (nunvisited--) {
         double best_extra_milage = DBL_MAX;
         int next;  /* next unvisited node to pick */
-        int edgei; /* edge index */
+        int after; /* the edge (after, child[after]) is broken */
 
         /* iterate over unvisited nodes */
         for (int i = 0; i < nnodes; i++) {
             if (visited[i]) continue;
 
-            /* iterate over saved edges */
+            /* iterate over the edges of the partial cycle */
             for (int j = 0; j < visnodes; j++) {
+                int u = chromosome[j], v = child[u];
                 double extra_milage =
-                    dist(i, child->edges[j].i, inst) +
-                    dist(i, child->edges[j].j, inst) -
-                    dist(child->edges[j].i, child->edges[j].j, inst);
+                    dist(i, u, inst) + dist(i, v, inst) - dist(u, v, inst);
 
                 if (extra_milage < best_extra_milage) {
                     best_extra_milage = extra_milage;
                     next = i;
-                    edgei = j;
+                    after = u;
                 }
             }
         }
 
-        /* add the new two edges to the saved ones:
-         * actually perform a substitution and add the other one
-         * also update the objective */
-        int oldi = child->edges[edgei].i;
-        int oldj = child->edges[edgei].j;
-        child->edges[edgei] = (edge){oldi, next};
-        child->edges[visnodes] = (edge){oldj, next};
-        visnodes++;
+        if (EXTRA_VERBOSE) {
+            printf("[VERBOSE] next: %d, break (%d, %d)\n", next + 1,
+                   after + 1, child[after] + 1);
+        }
 
+        /* (after, v) becomes (after, next), (next, v) */
+        child[next] = child[after];
+        child[after] = next;
+        chromosome[visnodes++] = next;
         visited[next] = 1;
 
-        child->zstar += best_extra_milage;
+        ga->zstar[c] += best_extra_milage;
+    }
+}
+
+void genetic_eax(genetic ga, instance inst, int p1, int p2, int c) {
+    int nnodes = inst->nnodes;
+
+    int* succ1 = ga->succ + (size_t)p1 * nnodes;
+    int* succ2 = ga->succ + (size_t)p2 * nnodes;
+    int* child = ga->succ + (size_t)c * nnodes;
+    int* link = ga->link;
 
-        if (EXTRA_VERBOSE) {
-            printf("[VERBOSE] next: %d, break (%d, %d)\n", next + 1, oldi + 1,
-                   oldj + 1);
+    /* the child starts as parent1, without orientation */
+    for (int u = 0; u < nnodes; u++) {
+        link[2 * u] = succ1[u];
+        link[2 * succ1[u] + 1] = u;
+    }
+
+    /* E-set of a single random AB-cycle: its A edges out, its B edges in */
+    int ncycles = eax_abcycles(ga, succ1, succ2);
+    if (ncycles > 0) {
+        int r = rng_int(&ga->r, ncycles);
+        int* cycle = ga->cycles + ga->cstart[r];
+        int len = ga->cstart[r + 1] - ga->cstart[r];
+
+        for (int i = 0; i < len; i += 2) {
+            eax_relink(link, cycle[i], cycle[i + 1], -1);
+            eax_relink(link, cycle[i + 1], cycle[i], -1);
+        }
+        for (int i = 1; i < len; i += 2) {
+            int u = cycle[i], v = cycle[(i + 1) % len];
+            eax_relink(link, u, -1, v);
+            eax_relink(link, v, -1, u);
         }
+
+        int ncomps = eax_subtours(ga);
+        if (ncomps > 1) eax_merge(ga, inst, ncomps);
     }
 
-    /* refine it! */
-    if ((succ = edges_tosucc(child->edges, nnodes)) == NULL) {
-        print_error("solver didnt produced a tour");
+    /* orient the child from node 0 */
+    ga->zstar[c] = 0.0;
+    int prev = link[1], v = 0;
+    for (int i = 0; i < nnodes; i++) {
+        int next = link[2 * v] == prev ? link[2 * v + 1] : link[2 * v];
+        child[v] = next;
+        ga->zstar[c] += dist(v, next, inst);
+
+        prev = v;
+        v = next;
     }
+    assert(v == 0 && "eax child is not a tour");
+}
 
-    /* if (nnodes < 750) */
-    /*     child->zstar += twoopt_refinement_notimelim(inst, succ, nnodes);
-     */
+int eax_abcycles(genetic ga, int* succ1, int* succ2) {
+    int nnodes = ga->nnodes;
+    int* aedges = ga->aedges;
+    int* bedges = ga->bedges;
+    int* walk = ga->walk;
+    int* walkpos = ga->walkpos;
 
-    /* store the succ as usual edges array */
-    for (int i = 0; i < nnodes; i++) {
-        child->edges[i] = (edge){i, succ[i]};
+    /* edges of a single parent, common ones cancel out */
+    for (int i = 0; i < 2 * nnodes; i++) {
+        aedges[i] = bedges[i] = walkpos[i] = -1;
     }
-    free(succ);
-    free(chromosome);
-    free(visited);
+    for (int u = 0; u < nnodes; u++) {
+        int v = succ1[u];
+        if (succ2[u] != v && succ2[v] != u) {
+            aedges[2 * u + (aedges[2 * u] >= 0)] = v;
+            aedges[2 * v + (aedges[2 * v] >= 0)] = u;
+        }
+
+        v = succ2[u];
+        if (succ1[u] != v && succ1[v] != u) {
+            bedges[2 * u + (bedges[2 * u] >= 0)] = v;
+            bedges[2 * v + (bedges[2 * v] >= 0)] = u;
+        }
+    }
+
+    /* random walk leaving even positions on A edges and odd ones on B edges:
+     * a node met again with the same parity closes an AB-cycle, which is cut
+     * off the walk. Every node has as many A as B edges, so the walk never
+     * gets stuck before coming back to its start */
+    int ncycles = 0, end = 0;
+    ga->cstart[0] = 0;
+    for (int start = 0; start < nnodes; start++) {
+        while (aedges[2 * start] >= 0 || aedges[2 * start + 1] >= 0) {
+            int len = 0;
+            walk[0] = start;
+            walkpos[2 * start] = 0;
+
+            do {
+                int v = walk[len];
+                int* edges = len % 2 == 0 ? aedges : bedges;
+
+                int h = edges[2 * v] >= 0 ? 0 : 1;
+                if (edges[2 * v] >= 0 && edges[2 * v + 1] >= 0) {
+                    h = rng_int(&ga->r, 2);
+                }
+                int w = edges[2 * v + h];
+                assert(w >= 0);
+
+                /* the edge is used at both ends */
+                edges[2 * v + h] = -1;
+                edges[2 * w + (edges[2 * w] == v ? 0 : 1)] = -1;
+
+                walk[++len] = w;
+                int p = walkpos[2 * w + len % 2];
+                if (p < 0) {
+                    walkpos[2 * w + len % 2] = len;
+                    continue;
+                }
+
+                /* walk[p], ..., walk[len - 1], stored from an A edge */
+                int shift = p % 2;
+                for (int i = 0; i < len - p; i++) {
+                    ga->cycles[end++] = walk[p + (i + shift) % (len - p)];
+                }
+                for (int i = p + 1; i < len; i++) {
+                    walkpos[2 * walk[i] + i % 2] = -1;
+                }
+                ga->cstart[++ncycles] = end;
+
+                len = p;
+            } while (len > 0);
 
-    return child;
+            walkpos[2 * start] = -1;
+        }
+    }
+
+    return ncycles;
 }
 
-solution TSPrandom(instance inst) {
-    int nnodes = inst->nnodes;
+void eax_relink(int* link, int u, int from, int to) {
+    /* the neighbor from of u becomes to */
+    int h = link[2 * u] == from ? 0 : 1;
+    assert(link[2 * u + h] == from);
 
-    unsigned int seedp = rand();
-    solution sol = create_solution(inst, GENETIC, nnodes);
+    link[2 * u + h] = to;
+}
 
-    int* succ = randomtour(nnodes, seedp);
-    for (int i = 0; i < nnodes; i++) {
-        sol->edges[i] = (edge){i, succ[i]};
-        sol->zstar += dist(i, succ[i], inst);
+int eax_subtours(genetic ga) {
+    int nnodes = ga->nnodes;
+    int* link = ga->link;
+
+    for (int v = 0; v < nnodes; v++) ga->comp[v] = -1;
+
+    int ncomps = 0;
+    for (int s = 0; s < nnodes; s++) {
+        if (ga->comp[s] >= 0) continue;
+
+        ga->csize[ncomps] = 0;
+        ga->cnode[ncomps] = s;
+
+        int prev = link[2 * s + 1], v = s;
+        do {
+            ga->comp[v] = ncomps;
+            ga->csize[ncomps]++;
+
+            int next = link[2 * v] == prev ? link[2 * v + 1] : link[2 * v];
+            prev = v;
+            v = next;
+        } while (v != s);
+
+        ncomps++;
     }
-    free(succ);
 
-    return sol;
+    return ncomps;
+}
+
+void eax_merge(genetic ga, instance inst, int ncomps) {
+    int nnodes = ga->nnodes;
+    int* link = ga->link;
+    int* comp = ga->comp;
+    int* nodes = ga->chromosome;
+    candidates cands = inst->cands;
+
+    for (int left = ncomps; left > 1; left--) {
+        /* the smallest subtour joins the closest one */
+        int s = -1;
+        for (int k = 0; k < ncomps; k++) {
+            if (ga->csize[k] == 0) continue;
+            if (s < 0 || ga->csize[k] < ga->csize[s]) s = k;
+        }
+
+        int n = 0, prev = link[2 * ga->cnode[s] + 1], v = ga->cnode[s];
+        do {
+            nodes[n++] = v;
+
+            int next = link[2 * v] == prev ? link[2 * v + 1] : link[2 * v];
+            prev = v;
+            v = next;
+        } while (v != ga->cnode[s]);
+
+        /* (x, y) of the subtour and (w, z) outside become (x, w), (y, z):
+         * w among the neighbors of x, every node if none is outside */
+        double best = DBL_MAX;
+        int bx = -1, by = -1, bw = -1, bz = -1;
+        for (int all = 0; all < 2 && bx < 0; all++) {
+            for (int i = 0; i < 2 * n; i++) {
+                int x = nodes[i / 2], y = nodes[(i / 2 + 1) % n];
+                if (i % 2) swap(&x, &y);
+                double dxy = dist(x, y, inst);
+
+                int* list = all ? NULL : candidates_list(cands, x);
+                int size = all ? nnodes : candidates_size(cands, x);
+                for (int k = 0; k < size; k++) {
+                    int w = all ? k : list[k];
+                    if (comp[w] == s) continue;
+
+                    double dxw = dist(x, w, inst);
+                    for (int h = 0; h < 2; h++) {
+                        int z = link[2 * w + h];
+                        double delta = dxw + dist(y, z, inst) - dxy -
+                                       dist(w, z, inst);
+
+                        if (delta < best) {
+                            best = delta;
+                            bx = x, by = y, bw = w, bz = z;
+                        }
+                    }
+                }
+            }
+        }
+        assert(bx >= 0);
+
+        eax_relink(link, bx, by, bw);
+        eax_relink(link, by, bx, bz);
+        eax_relink(link, bw, bz, bx);
+        eax_relink(link, bz, bw, by);
+
+        int t = comp[bw];
+        for (int i = 0; i < n; i++) comp[nodes[i]] = t;
+        ga->csize[t] += ga->csize[s];
+        ga->csize[s] = 0;
+    }
 }
 
-/* OLD TSPrandom */
-/* int* tour = (int*)calloc(nnodes, sizeof(int)); */
-/* int* succ = (int*)calloc(nnodes, sizeof(int)); */
-/*  */
-/* int permutation_steps = 2 * nnodes; */
-/*  */
-/* for (int i = 0; i < nnodes; i++) tour[i] = i; */
-/*  */
-/* for (int i = 0; i < permutation_steps; i++) { */
-/*     swap(&tour[rand() % nnodes], &tour[rand() % nnodes]); */
-/* } */
-/*  */
-/* for (int i = 0; i < nnodes; i++) { */
-/*     sol->zstar += dist(tour[i], tour[(i + 1) % nnodes], inst); */
-/*     succ[tour[i]] = tour[(i + 1) % nnodes]; */
-/* } */
-/*  */
-/* #<{(| store the succ as usual edges array |)}># */
-/* for (int j = 0; j < nnodes; j++) { */
-/*     sol->edges[j] = (edge){j, succ[j]}; */
-/* } */
-/* free(succ); */
-/* free(tour); */
+int genetic_mutate(genetic ga, instance inst, int id, struct timespec* s,
+                   struct timespec* e) {
+    /* a few best improvement 2opt moves, on the arena scratch: returns 1 if
+     * the time limit is reached */
+    int nnodes = inst->nnodes;
+    int* succ = ga->succ + (size_t)id * nnodes;
+
+    for (int j = 0; j < GENETIC_NMOVES; j++) {
+        int a, b;
+        double deltabest = twoopt_pick(inst, succ, ga->dsucc, &a, &b);
+
+        if (stopwatch(s, e) / 1000.0 > inst->params->timelimit) return 1;
+        if (deltabest == 0.0) break; /* no more moves possible */
+
+        if (EXTRA_VERBOSE) {
+            printf("[VERBOSE] refinement on %d, %d delta %lf\n", a, b,
+                   deltabest);
+        }
+
+        twoopt_move(succ, nnodes, a, b);
+        ga->zstar[id] += deltabest;
+    }
+
+    return 0;
+}
@@ -164,12 +164,16 @@ void add_symm_variables(CPXENVptr env, CPXLPptr lp, instance inst) {
 
     /* add a single binary variables x(i,j) for i < j at the time */
     int nnodes = inst->nnodes;
+    double* row = (double*)malloc(nnodes * sizeof(double));
     for (int i = 0; i < nnodes; i++) {
+        /* costs of the whole row in a single batch */
+        dist_row(inst, i, i + 1, nnodes - i - 1, row);
+
         for (int j = i + 1; j < nnodes; j++) {
             /* write name of 1-indexed variable insede CPLEX
              * compute cost of var as distance x(i,j) */
             snprintf(cname[0], strlen(cname[0]), "x(%d-%d)", i + 1, j + 1);
-            double obj = dist(i, j, inst);
+            double obj = row[j - i - 1];
 
             /* inject variable and test it's position (xpos) inside CPLEX */
             if (CPXnewcols(env, lp, 1, &obj, &lb, &ub, &binary, cname)) {
@@ -185,6 +189,7 @@ void add_symm_variables(CPXENVptr env, CPXLPptr lp, instance inst) {
     /* int this case is n chooses 2 cause of symmetry */
     inst->ncols = nnodes * (nnodes - 1) / 2;
 
+    free(row);
     free(cname[0]);
     free(cname);
 }
@@ -37,6 +37,10 @@ enum sections {
 enum sections section_enumerator(char* section_name);
 enum instance_types instance_type_enumerator(char* section_param);
 enum weight_types weight_type_enumerator(char* section_param);
+enum distcache_types distcache_type_enumerator(char* type_name);
+enum candidate_types candidate_type_enumerator(char* type_name);
+enum refinement_types refinement_type_enumerator(char* type_name);
+enum crossover_types crossover_type_enumerator(char* type_name);
 
 run_options create_options() {
     run_options options = (run_options)calloc(1, sizeof(struct run_options_t));
@@ -64,12 +68,17 @@ void print_usage() {
     printf("  -N --nnodes <number of nodes of generated instances>\n");
     printf("  -m --models <execute models>\n");
     printf("  -T --time_limit <time limit in seconds>\n");
-    printf("  -S --cplex_seed <cplex seed>\n");
+    printf("  -S --cplex_seed <cplex and heuristics seed>\n");
     printf("  -C --threads <threads to use>\n");
     printf("  -M --memory <max memory usage in MB>\n");
+    printf("  -D --distance_cache <none|double|float|int|rows>\n");
+    printf("  -K --candidates <knn|delaunay>\n");
+    printf("  -R --refinement <twoopt|neighbor|oropt|lk>\n");
+    printf("  -X --crossover <order|eax>\n");
+    printf("  -L --neighbor_lists (grasp and tabu search on the candidates)\n");
     printf("  -h --help\n");
     printf("  avaiable models:\n");
-    for (int i = 0; i < 28; i++) {
+    for (int i = 0; i < 29; i++) {
         char* model_type_str = model_type_tostring(i);
         printf("\t%s: %d\n", model_type_str, 1 << i);
         free(model_type_str);
@@ -97,12 +106,17 @@ void parse_command_line(int argc, char** argv, cplex_params params,
         {"cplex_seed", required_argument, NULL, 'S'},
         {"threads", required_argument, NULL, 'C'},
         {"memory", required_argument, NULL, 'M'},
+        {"distance_cache", required_argument, NULL, 'D'},
+        {"candidates", required_argument, NULL, 'K'},
+        {"refinement", required_argument, NULL, 'R'},
+        {"crossover", required_argument, NULL, 'X'},
+        {"neighbor_lists", no_argument, NULL, 'L'},
         {"help", no_argument, NULL, 'h'},
         {0, 0, NULL, 0}};
 
     int long_index, opt;
     long_index = opt = 0;
-    while ((opt = getopt_long(argc, argv, "vecn:l:og:N:m:T:S:C:M:h",
+    while ((opt = getopt_long(argc, argv, "vecn:l:og:N:m:T:S:C:M:D:K:R:X:Lh",
                               long_options, &long_index)) != -1) {
         switch (opt) {
             case 'v':
@@ -163,6 +177,21 @@ void parse_command_line(int argc, char** argv, cplex_params params,
             case 'M':
                 params->available_memory = atoi(optarg);
                 break;
+            case 'D':
+                params->distance_cache = distcache_type_enumerator(optarg);
+                break;
+            case 'K':
+                params->candidate_type = candidate_type_enumerator(optarg);
+                break;
+            case 'R':
+                params->refinement_type = refinement_type_enumerator(optarg);
+                break;
+            case 'X':
+                params->crossover_type = crossover_type_enumerator(optarg);
+                break;
+            case 'L':
+                params->neighbor_lists = 1;
+                break;
             case 'h':
                 print_usage();
                 break;
@@ -444,3 +473,43 @@ enum weight_types weight_type_enumerator(char* section_param) {
     }
     return UNHANDLED_WEIGHT_TYPE;
 }
+enum distcache_types distcache_type_enumerator(char* type_name) {
+    char* distcache_types[] = {"none", "double", "float", "int", "rows"};
+
+    for (int i = NO_CACHE; i <= ROW_CACHE; i++) {
+        if (!strcmp(type_name, distcache_types[i])) return i;
+    }
+
+    print_error("unknown distance cache %s", type_name);
+    return NO_CACHE; /* warning suppressor */
+}
+enum candidate_types candidate_type_enumerator(char* type_name) {
+    char* candidate_types[] = {"knn", "delaunay"};
+
+    for (int i = KNN_CANDIDATES; i <= DELAUNAY_CANDIDATES; i++) {
+        if (!strcmp(type_name, candidate_types[i])) return i;
+    }
+
+    print_error("unknown candidates %s", type_name);
+    return KNN_CANDIDATES; /* warning suppressor */
+}
+enum refinement_types refinement_type_enumerator(char* type_name) {
+    char* refinement_types[] = {"twoopt", "neighbor", "oropt", "lk"};
+
+    for (int i = TWOOPT_REFINEMENT; i <= LK_REFINEMENT; i++) {
+        if (!strcmp(type_name, refinement_types[i])) return i;
+    }
+
+    print_error("unknown refinement %s", type_name);
+    return TWOOPT_REFINEMENT; /* warning suppressor */
+}
+enum crossover_types crossover_type_enumerator(char* type_name) {
+    char* crossover_types[] = {"order", "eax"};
+
+    for (int i = ORDER_CROSSOVER; i <= EAX_CROSSOVER; i++) {
+        if (!strcmp(type_name, crossover_types[i])) return i;
+    }
+
+    print_error("unknown crossover %s", type_name);
+    return ORDER_CROSSOVER; /* warning suppressor */
+}
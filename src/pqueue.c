@@ -3,7 +3,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 
 #include "../include/globals.h"
 
@@ -13,8 +13,8 @@ int left(int i);
 int right(int i);
 
 /* node helpers */
-pqueue_node create_node(double key, int val);
-void swap_node(pqueue_node* n, pqueue_node* m);
+int pqueue_before(pqueue pq, double a, double b);
+void pqueue_place(pqueue pq, int i, pqueue_node n);
 
 /* heap shift operations */
 void shiftup(pqueue pq, int i);
@@ -26,83 +26,43 @@ int left(int i) { return 2 * i + 1; }
 int right(int i) { return 2 * i + 2; }
 
 /* node helpers */
-pqueue_node create_node(double key, int val) {
-    pqueue_node n = (pqueue_node)calloc(1, sizeof(struct pqueue_node_t));
-    n->key = key;
-    n->val = val;
-
-    return n;
+int pqueue_before(pqueue pq, double a, double b) {
+    /* key a goes closer to the top than key b */
+    return pq->mode == MIN_HEAP ? a < b : a > b;
 }
 
-void swap_node(pqueue_node* n, pqueue_node* m) {
-    pqueue_node temp = *n;
-    *n = *m;
-    *m = temp;
+void pqueue_place(pqueue pq, int i, pqueue_node n) {
+    pq->data[i] = n;
+    if (pq->pos != NULL) pq->pos[n.val] = i;
 }
 
-/* heap shift operations */
+/* heap shift operations: the node in i moves along a hole, written once */
 void shiftup(pqueue pq, int i) {
-    switch (pq->mode) {
-        case MIN_HEAP: {
-            while (i > 0 &&
-                   pq->data[parent(i)]->key - pq->data[i]->key > -EPSILON) {
-                swap_node(&pq->data[parent(i)], &pq->data[i]);
-                i = parent(i);
-            }
-            break;
-        }
-        case MAX_HEAP: {
-            while (i > 0 &&
-                   pq->data[parent(i)]->key - pq->data[i]->key < EPSILON) {
-                swap_node(&pq->data[parent(i)], &pq->data[i]);
-                i = parent(i);
-            }
-            break;
-        }
+    pqueue_node n = pq->data[i];
+
+    while (i > 0 && pqueue_before(pq, n.key, pq->data[parent(i)].key)) {
+        pqueue_place(pq, i, pq->data[parent(i)]);
+        i = parent(i);
     }
+    pqueue_place(pq, i, n);
 }
 
 void shiftdown(pqueue pq, int i) {
-    switch (pq->mode) {
-        case MIN_HEAP: {
-            int min_index = i;
-
-            int l = left(i);
-            if (l <= pq->size &&
-                pq->data[l]->key - pq->data[min_index]->key < EPSILON)
-                min_index = l;
-
-            int r = right(i);
-            if (r <= pq->size &&
-                pq->data[r]->key - pq->data[min_index]->key < EPSILON)
-                min_index = r;
-
-            if (i != min_index) {
-                swap_node(&pq->data[i], &pq->data[min_index]);
-                shiftdown(pq, min_index);
-            }
-            break;
-        }
-        case MAX_HEAP: {
-            int max_index = i;
-
-            int l = left(i);
-            if (l <= pq->size &&
-                pq->data[l]->key - pq->data[max_index]->key > -EPSILON)
-                max_index = l;
-
-            int r = right(i);
-            if (r <= pq->size &&
-                pq->data[r]->key - pq->data[max_index]->key > -EPSILON)
-                max_index = r;
-
-            if (i != max_index) {
-                swap_node(&pq->data[i], &pq->data[max_index]);
-                shiftdown(pq, max_index);
-            }
-            break;
+    pqueue_node n = pq->data[i];
+
+    while (left(i) < pq->size) {
+        int child = left(i);
+        if (right(i) < pq->size &&
+            pqueue_before(pq, pq->data[right(i)].key, pq->data[child].key)) {
+            child = right(i);
         }
+
+        if (!pqueue_before(pq, pq->data[child].key, n.key)) break;
+
+        pqueue_place(pq, i, pq->data[child]);
+        i = child;
     }
+    pqueue_place(pq, i, n);
 }
 
 /* priority queue operations */
@@ -111,43 +71,96 @@ pqueue pqueue_create(enum modes mode) {
 
     pq->size = 0;
     pq->capacity = 10;
-    pq->data = (pqueue_node*)calloc(10, sizeof(struct pqueue_node_t));
+    pq->data = (pqueue_node*)malloc(pq->capacity * sizeof(pqueue_node));
     pq->mode = mode;
+    pq->pos = NULL;
+
+    return pq;
+}
+
+pqueue pqueue_create_indexed(enum modes mode, int nvals) {
+    assert(nvals > 0);
+
+    pqueue pq = pqueue_create(mode);
+    pq->nvals = nvals;
+    pq->pos = (int*)malloc(nvals * sizeof(int));
+    memset(pq->pos, -1, nvals * sizeof(int));
 
     return pq;
 }
 
 int pqueue_empty(pqueue pq) { return pq->size == 0; }
 
-int pqueue_top(pqueue pq) { return pq->data[0]->val; }
+int pqueue_top(pqueue pq) { return pq->data[0].val; }
 
-double pqueue_top_key(pqueue pq) { return pq->data[0]->key; }
+double pqueue_top_key(pqueue pq) { return pq->data[0].key; }
 
 int pqueue_pop(pqueue pq) {
     assert(pq->size != 0);
 
-    int result = pq->data[0]->val;
-    free(pq->data[0]);
-    pq->data[0] = pq->data[pq->size - 1];
+    int result = pq->data[0].val;
+    if (pq->pos != NULL) pq->pos[result] = -1;
 
     pq->size--;
-
-    shiftdown(pq, 0);
+    if (pq->size > 0) {
+        pq->data[0] = pq->data[pq->size];
+        shiftdown(pq, 0);
+    }
 
     return result;
 }
 
 void pqueue_push(pqueue pq, double key, int val) {
-    pq->size++;
-
-    if (pq->size >= pq->capacity) {
+    if (pq->size == pq->capacity) {
         pq->capacity = 2 * pq->capacity;
-        pq->data = (pqueue_node*)realloc(
-            pq->data, pq->capacity * sizeof(struct pqueue_node_t));
+        pq->data = (pqueue_node*)realloc(pq->data,
+                                         pq->capacity * sizeof(pqueue_node));
     }
-    pq->data[pq->size - 1] = create_node(key, val);
+    assert(pq->pos == NULL || !pqueue_contains(pq, val));
+
+    pq->data[pq->size] = (pqueue_node){key, val};
+    shiftup(pq, pq->size++);
+}
+
+int pqueue_contains(pqueue pq, int val) {
+    assert(pq->pos != NULL && val >= 0 && val < pq->nvals);
+
+    return pq->pos[val] >= 0;
+}
+
+double pqueue_key(pqueue pq, int val) {
+    assert(pqueue_contains(pq, val));
+
+    return pq->data[pq->pos[val]].key;
+}
+
+void pqueue_decrease_key(pqueue pq, int val, double key) {
+    /* decrease in priority order: the new key never sends val down */
+    assert(pqueue_contains(pq, val));
+
+    int i = pq->pos[val];
+    assert(!pqueue_before(pq, pq->data[i].key, key));
 
-    shiftup(pq, pq->size - 1);
+    pq->data[i].key = key;
+    shiftup(pq, i);
+}
+
+void pqueue_remove(pqueue pq, int val) {
+    assert(pqueue_contains(pq, val));
+
+    int i = pq->pos[val];
+    pq->pos[val] = -1;
+
+    /* the last node fills the hole, then goes either way */
+    pq->size--;
+    if (i == pq->size) return;
+
+    pq->data[i] = pq->data[pq->size];
+    if (i > 0 && pqueue_before(pq, pq->data[i].key, pq->data[parent(i)].key)) {
+        shiftup(pq, i);
+    } else {
+        shiftdown(pq, i);
+    }
 }
 
 void pqueue_print(pqueue pq) {
@@ -156,67 +169,82 @@ void pqueue_print(pqueue pq) {
         return;
     }
 
+    /* pop a copy, the queue is left untouched */
     pqueue temp = pqueue_create(pq->mode);
-
-    while (!pqueue_empty(pq)) {
-        double key = pq->data[0]->key;
-        int val = pqueue_pop(pq);
-        printf(" (%.3lf: , %d)", key, val);
-
-        pqueue_push(temp, key, val);
+    for (int i = 0; i < pq->size; i++) {
+        pqueue_push(temp, pq->data[i].key, pq->data[i].val);
     }
+
     while (!pqueue_empty(temp)) {
-        double key = temp->data[0]->key;
+        double key = pqueue_top_key(temp);
         int val = pqueue_pop(temp);
-        pqueue_push(pq, key, val);
+        printf(" (%.3lf: , %d)", key, val);
     }
     printf("\n");
+
+    pqueue_free(temp);
 }
 void pqueue_free(pqueue pq) {
-    for (int i = 0; i < pq->size; i++) free(pq->data[i]);
+    if (pq == NULL) return;
+
     free(pq->data);
+    free(pq->pos);
     free(pq);
 }
 
-/* topkqueue wrapper */
+/* topkqueue operations */
 topkqueue topkqueue_create(int k) {
-    topkqueue tk = (topkqueue)malloc(sizeof(struct topkqueue_t));
-    tk->pq = pqueue_create(MAX_HEAP);
+    assert(k > 0);
+
+    topkqueue tk = (topkqueue)calloc(1, sizeof(struct topkqueue_t));
     tk->k = k;
+    tk->size = 0;
+    tk->keys = (double*)malloc(k * sizeof(double));
+    tk->vals = (int*)malloc(k * sizeof(int));
 
     return tk;
 }
 
 void topkqueue_push(topkqueue tk, double key, int val) {
-    if (tk->pq->size < tk->k) {
-        /* if not enought pairs simply insert */
-        pqueue_push(tk->pq, key, val);
-    } else {
-        /* new pair can enter if its key is lower than bigger one */
-        if (key < pqueue_top_key(tk->pq)) {
-            /* remove last pair (the one with bigger key) */
-            pqueue_pop(tk->pq);
-            /* insert newone */
-            pqueue_push(tk->pq, key, val);
-        }
+    /* new pair can enter if its key is lower than bigger one */
+    if (tk->size == tk->k && key >= tk->keys[tk->k - 1]) return;
+
+    /* insertion from the back, the bigger key falls off when full */
+    int i = tk->size < tk->k ? tk->size++ : tk->k - 1;
+    for (; i > 0 && tk->keys[i - 1] > key; i--) {
+        tk->keys[i] = tk->keys[i - 1];
+        tk->vals[i] = tk->vals[i - 1];
     }
+    tk->keys[i] = key;
+    tk->vals[i] = val;
 }
 
-int topkqueue_randompick(topkqueue tk) {
-    unsigned int seedp = time(NULL);
-    int npops = rand_r(&seedp) % tk->pq->size;
-    while (npops--) pqueue_pop(tk->pq);
-    int ans = pqueue_top(tk->pq);
+int topkqueue_randompick(topkqueue tk, rng* r) {
+    assert(tk->size > 0);
 
-    /* let's also free the nodes, there the overhead of shiftdown only */
-    while (!pqueue_empty(tk->pq)) pqueue_pop(tk->pq);
+    /* uniform among the pairs kept, the queue is emptied */
+    int ans = tk->vals[rng_int(r, tk->size)];
+    tk->size = 0;
 
     return ans;
 }
 
-void topkqueue_print(topkqueue tk) { pqueue_print(tk->pq); }
+void topkqueue_print(topkqueue tk) {
+    if (tk->size == 0) {
+        printf("<empty queue>\n");
+        return;
+    }
+
+    for (int i = 0; i < tk->size; i++) {
+        printf(" (%.3lf: , %d)", tk->keys[i], tk->vals[i]);
+    }
+    printf("\n");
+}
 
 void topkqueue_free(topkqueue tk) {
-    pqueue_free(tk->pq);
+    if (tk == NULL) return;
+
+    free(tk->keys);
+    free(tk->vals);
     free(tk);
 }
@@ -4,64 +4,57 @@
 
 #include <assert.h>
 #include <float.h>
+#include <math.h>
+#include <omp.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <time.h>
 
+#include "../include/candidates.h"
 #include "../include/constructives.h"
 #include "../include/globals.h"
-#include "../include/union_find.h"
+#include "../include/lk.h"
+#include "../include/tour.h"
 #include "../include/utils.h"
 
-solution TSPtwoopt_multistart(instance inst) {
-    assert(inst != NULL);
-    assert(inst->params != NULL);
+/* parallel multistart helpers */
+int multistart_publish(_Atomic double* best, double obj);
 
-    int nnodes = inst->nnodes;
+/* parallel 2opt helpers */
+void twoopt_reduce(double delta, int i, int j, double* deltabest, int* a,
+                   int* b);
 
-    /* track the best solution up to this point */
-    solution sol = create_solution(inst, TWOOPT_MULTISTART, nnodes);
-    sol->distance_time = 0.0;
-    sol->zstar = DBL_MAX;
+/* 2opt cache helpers */
+void twoopt_cache_update(twoopt_cache tc, instance inst, int* succ,
+                         int nchanged);
+void twoopt_cache_row(twoopt_cache tc, instance inst, int* succ, int i);
 
-    /* initialize total wall-clock time */
-    struct timespec s, e;
-    s.tv_sec = e.tv_sec = -1;
-    stopwatch(&s, &e);
-
-    int k = 0;
-    while (stopwatch(&s, &e) / 1000.0 < inst->params->timelimit) {
-        /* generate initial grasp solution */
-        solution start = TSPgrasp(inst, TWOOPT_NINITIALSOL);
-        if (VERBOSE) {
-            printf("[VERBOSE] start obj: %lf (%d grasp starts)\n", start->zstar,
-                   TWOOPT_NINITIALSOL);
-        }
-        if (stopwatch(&s, &e) / 1000.0 > inst->params->timelimit) break;
+/* neighbor lists 2opt helpers */
+void dlb_push(int* queue, char* inqueue, int nnodes, int* tail, int i);
+double twoopt_neighbor_move(instance inst, tour t, candidates c, int a,
+                            int* touched);
 
-        int* succ;
-        if ((succ = edges_tosucc(start->edges, nnodes)) == NULL) {
-            print_error("no solution found!");
-        }
-
-        /* refine */
-        start->zstar += twoopt_refinement(inst, succ, nnodes, &s, &e);
+/* neighbor lists 3opt helpers */
+double threeopt_neighbor_move(instance inst, tour t, candidates c, int t1,
+                              int* touched);
+int threeopt_reconnection(tour t, int t1, int t2, int t3, int t4, int t5,
+                          int t6, int* a, int* b, int* c);
 
-        if (VERBOSE) {
-            printf("[VERBOSE] refined solution: %lf \n", start->zstar);
-        }
+/* oropt helpers */
+void oropt_segment(tour t, int a, int len, int dir, int* s1, int* s2);
+double oropt_neighbor_move(instance inst, tour t, candidates c, int a,
+                           int* touched);
 
-        /* select best tour */
-        if (start->zstar < sol->zstar) {
-            for (int i = 0; i < nnodes; i++) {
-                sol->edges[i] = (edge){i, succ[i]};
-            }
-            sol->zstar = start->zstar;
+solution TSPtwoopt_multistart(instance inst) {
+    assert(inst != NULL);
+    assert(inst->params != NULL);
 
-            tracker_add(sol->t, stopwatch(&s, &e), sol->zstar);
-        }
+    /* track the best solution up to this point */
+    solution sol = create_solution(inst, TWOOPT_MULTISTART, inst->nnodes);
+    sol->distance_time = 0.0;
+    sol->zstar = DBL_MAX;
 
-        k++;
-    }
+    multistart(inst, sol, TWOOPT_MULTISTART);
 
     return sol;
 }
@@ -70,55 +63,142 @@ solution TSPthreeopt_multistart(instance inst) {
     assert(inst != NULL);
     assert(inst->params != NULL);
 
-    int nnodes = inst->nnodes;
-
     /* track the best solution up to this point */
-    solution sol = create_solution(inst, THREEOPT_MULTISTART, nnodes);
+    solution sol = create_solution(inst, THREEOPT_MULTISTART, inst->nnodes);
     sol->distance_time = 0.0;
     sol->zstar = DBL_MAX;
 
+    multistart(inst, sol, THREEOPT_MULTISTART);
+
+    return sol;
+}
+
+void multistart(instance inst, solution sol, enum model_types model_type) {
+    int nnodes = inst->nnodes;
+
+    /* the candidates are built once, before the workers need them: 3opt,
+     * lk and the neighbor lists refinements and grasp */
+    if (model_type != TWOOPT_MULTISTART || inst->params->neighbor_lists ||
+        inst->params->refinement_type != TWOOPT_REFINEMENT) {
+        build_candidates(inst);
+    }
+    candidates c = inst->params->neighbor_lists ? inst->cands : NULL;
+
     /* initialize total wall-clock time */
     struct timespec s, e;
     s.tv_sec = e.tv_sec = -1;
     stopwatch(&s, &e);
 
-    int k = 0;
-    while (stopwatch(&s, &e) / 1000.0 < inst->params->timelimit) {
-        /* generate initial grasp solution */
-        solution start = TSPgrasp(inst, TWOOPT_NINITIALSOL);
-        if (VERBOSE) {
-            printf("[VERBOSE] start obj: %lf (%d grasp starts)\n", start->zstar,
-                   TWOOPT_NINITIALSOL);
-        }
-        if (stopwatch(&s, &e) / 1000.0 > inst->params->timelimit) break;
+    /* objective of sol, published without locks: the tour itself is copied
+     * in the critical section. The best construction before any refinement
+     * is shared the same way, for the workers to drop the hopeless ones */
+    _Atomic double incumbent = DBL_MAX;
+    _Atomic double construction = DBL_MAX;
+
+#pragma omp parallel num_threads(heuristic_threads(inst))
+    {
+        struct timespec ts = s, te = e;
+        rng r;
+        rng_seed(&r, inst->params->randomseed, omp_get_thread_num());
+
+        /* scratch of the worker */
+        int* succ = (int*)malloc(nnodes * sizeof(int));
+        int* start = (int*)malloc(nnodes * sizeof(int));
+        double* row = (double*)malloc(nnodes * sizeof(double));
+        topkqueue tk = topkqueue_create(GRASP_K);
+        double lastgrasp = 0.0; /* seconds of the last construction */
+
+        while (stopwatch(&ts, &te) / 1000.0 < inst->params->timelimit) {
+            /* a start that cannot end in time is useless once a tour is
+             * stored */
+            if (atomic_load(&incumbent) < DBL_MAX &&
+                stopwatch(&ts, &te) / 1000.0 + lastgrasp >
+                    inst->params->timelimit) {
+                break;
+            }
 
-        int* succ;
-        if ((succ = edges_tosucc(start->edges, nnodes)) == NULL) {
-            print_error("no solution found!");
-        }
+            /* best of the grasp starts: a construction stops once longer
+             * than the best one of the batch or far from the best one of
+             * every worker, refined tours are no term of comparison */
+            double bound = atomic_load(&construction) * MULTISTART_HOPELESS;
+            double obj = DBL_MAX;
+
+            /* on large instances the batch would eat the time limit: it
+             * gets a share of what is left, the refinement the rest */
+            double now = stopwatch(&ts, &te) / 1000.0;
+            double batchend =
+                now + (inst->params->timelimit - now) * MULTISTART_GRASP_SHARE;
+            for (int k = 0; k < TWOOPT_NINITIALSOL; k++) {
+                if (k > 0 && now > batchend) break;
+
+                double z = grasp_tour(inst, succ, row, tk, c, fmin(obj, bound),
+                                      &r);
+                double end = stopwatch(&ts, &te) / 1000.0;
+                lastgrasp = end - now;
+                now = end;
+                if (z < obj) {
+                    int* tmp = start;
+                    start = succ;
+                    succ = tmp;
+                    obj = z;
+                }
+            }
+            /* even past the time limit the best construction is kept, the
+             * refinement returns at once */
+            if (obj == DBL_MAX) continue; /* hopeless restart */
+            multistart_publish(&construction, obj);
+
+            if (VERBOSE) {
+                printf("[VERBOSE] start obj: %lf (%d grasp starts)\n", obj,
+                       TWOOPT_NINITIALSOL);
+            }
 
-        /* refine */
-        start->zstar += threeopt_refinement(inst, succ, nnodes, &s, &e);
-        start->zstar += twoopt_refinement(inst, succ, nnodes, &s, &e);
+            /* refine */
+            switch (model_type) {
+                case THREEOPT_MULTISTART:
+                    obj += threeopt_refinement(inst, start, nnodes, &ts, &te);
+                    obj += twoopt_refinement(inst, start, nnodes, &ts, &te);
+                    break;
+                case LIN_KERNIGHAN:
+                    obj += lk_refinement(inst, start, nnodes, &ts, &te);
+                    break;
+                default:
+                    obj += refine(inst, start, nnodes, &ts, &te);
+                    break;
+            }
 
-        if (VERBOSE) {
-            printf("[VERBOSE] refined solution: %lf \n", start->zstar);
-        }
+            if (VERBOSE) printf("[VERBOSE] refined solution: %lf \n", obj);
 
-        /* select best tour */
-        if (start->zstar < sol->zstar) {
-            for (int i = 0; i < nnodes; i++) {
-                sol->edges[i] = (edge){i, succ[i]};
-            }
-            sol->zstar = start->zstar;
+            /* select best tour: a worker may have published a better one
+             * between the exchange and the critical section */
+            if (multistart_publish(&incumbent, obj)) {
+#pragma omp critical(multistart)
+                if (obj < sol->zstar) {
+                    for (int i = 0; i < nnodes; i++) {
+                        sol->edges[i] = (edge){i, start[i]};
+                    }
+                    sol->zstar = obj;
 
-            tracker_add(sol->t, stopwatch(&s, &e), sol->zstar);
+                    tracker_add(sol->t, stopwatch(&ts, &te), sol->zstar);
+                }
+            }
         }
 
-        k++;
+        free(succ);
+        free(start);
+        free(row);
+        topkqueue_free(tk);
     }
+}
 
-    return sol;
+int multistart_publish(_Atomic double* best, double obj) {
+    /* lower best to obj, unless another worker got below it */
+    double current = atomic_load(best);
+    while (obj < current) {
+        if (atomic_compare_exchange_weak(best, &current, obj)) return 1;
+    }
+
+    return 0;
 }
 
 double twoopt_delta(instance inst, int* succ, int i, int j) {
@@ -133,18 +213,23 @@ double twoopt_refinement_notimelim(instance inst, int* succ, int nnodes) {
     double delta;
     a = b = 0;
 
+    /* best move of each row, updated after every move */
+    twoopt_cache tc = twoopt_cache_create(inst, succ, 0);
+
     /* iterate over 2opt moves until not improvable */
-    while ((delta = twoopt_pick(inst, succ, &a, &b)) != 0.0) {
+    while ((delta = twoopt_cache_pick(tc, &a, &b)) < 0.0) {
         if (EXTRA_VERBOSE) {
             printf("[VERBOSE] refinement on %d, %d delta %lf\n", a, b, delta);
         }
 
         /* actually perform the move */
-        twoopt_move(succ, nnodes, a, b);
+        twoopt_cache_move(tc, inst, succ, a, b);
         /* update the objective */
         improvement += delta; /* delta should be negative */
     }
 
+    twoopt_cache_free(tc);
+
     return improvement;
 }
 
@@ -156,444 +241,937 @@ double twoopt_refinement(instance inst, int* succ, int nnodes,
     double delta;
     a = b = 0;
 
+    /* best move of each row, updated after every move */
+    twoopt_cache tc = twoopt_cache_create(inst, succ, 0);
+
     /* iterate over 2opt moves until not improvable */
-    while ((delta = twoopt_pick(inst, succ, &a, &b)) != 0.0 &&
+    while ((delta = twoopt_cache_pick(tc, &a, &b)) < 0.0 &&
            stopwatch(s, e) / 1000.0 < inst->params->timelimit) {
         if (EXTRA_VERBOSE) {
             printf("[VERBOSE] refinement on %d, %d delta %lf\n", a, b, delta);
         }
 
         /* actually perform the move */
-        twoopt_move(succ, nnodes, a, b);
+        twoopt_cache_move(tc, inst, succ, a, b);
         /* update the objective */
         improvement += delta; /* delta should be negative */
     }
 
+    twoopt_cache_free(tc);
+
     return improvement;
 }
 
-double twoopt_pick(instance inst, int* succ, int* a, int* b) {
+double twoopt_neighbor_refinement(instance inst, int* succ, int nnodes,
+                                  struct timespec* s, struct timespec* e) {
     assert(inst != NULL);
-    int nnodes, nedges;
-    nnodes = nedges = inst->nnodes;
+    assert(succ != NULL);
 
-    double deltabest;
-    deltabest = 0.0; /* select also positive delta */
-    *a = *b = 0;
+    build_candidates(inst);
+    candidates c = inst->cands;
 
-    for (int i = 0; i < nnodes; i++) {
-        for (int j = i + 1; j < nnodes; j++) {
-            double delta = twoopt_delta(inst, succ, i, j);
+    double improvement = 0.0;
+
+    /* array tour: moves reverse the shorter side */
+    tour t = tour_from_succ(succ, nnodes);
+
+    /* don't look bits: a node is looked at only while in the queue, it
+     * enters again when one of its tour edges changes */
+    int* queue = (int*)malloc(nnodes * sizeof(int));
+    char* inqueue = (char*)calloc(nnodes, sizeof(char));
+    int head = 0, tail = 0, size = 0;
+    for (int i = 0, v = 0; i < nnodes; i++, v = tour_next(t, v)) {
+        dlb_push(queue, inqueue, nnodes, &tail, v);
+        size++;
+    }
 
-            if (delta < deltabest) {
-                deltabest = delta;
-                *a = i;
-                *b = j;
+    int touched[4];
+    while (size > 0 && stopwatch(s, e) / 1000.0 < inst->params->timelimit) {
+        int a = queue[head];
+        head = (head + 1) % nnodes;
+        inqueue[a] = 0;
+        size--;
+
+        double delta = twoopt_neighbor_move(inst, t, c, a, touched);
+        if (delta > -EPSILON) continue;
+
+        improvement += delta;
+
+        for (int i = 0; i < 4; i++) {
+            if (inqueue[touched[i]]) continue;
+            dlb_push(queue, inqueue, nnodes, &tail, touched[i]);
+            size++;
+        }
+    }
+
+    tour_to_succ(t, succ);
+
+    tour_free(t);
+    free(queue);
+    free(inqueue);
+
+    return improvement;
+}
+
+void dlb_push(int* queue, char* inqueue, int nnodes, int* tail, int i) {
+    queue[*tail] = i;
+    *tail = (*tail + 1) % nnodes;
+    inqueue[i] = 1;
+}
+
+double twoopt_neighbor_move(instance inst, tour t, candidates c, int a,
+                            int* touched) {
+    int* list = candidates_list(c, a);
+    int ncands = candidates_size(c, a);
+
+    /* both tour neighbors of a: first improvement */
+    for (int dir = 0; dir < 2; dir++) {
+        int an = dir == 0 ? tour_next(t, a) : tour_prev(t, a);
+        double dan = dist(a, an, inst);
+
+        for (int k = 0; k < ncands; k++) {
+            int b = list[k];
+            double dab = dist(a, b, inst);
+
+            /* sorted lists: no gain possible from here on */
+            if (dab >= dan) break;
+
+            int bn = dir == 0 ? tour_next(t, b) : tour_prev(t, b);
+            if (b == an || bn == a) continue;
+
+            double delta =
+                dab + dist(an, bn, inst) - (dan + dist(b, bn, inst));
+            if (delta > -EPSILON) continue;
+
+            /* (a, an), (b, bn) becomes (a, b), (an, bn) */
+            tour_make2opt(t, a, an, b, bn);
+
+            if (EXTRA_VERBOSE) {
+                printf("[VERBOSE] refinement on %d, %d delta %lf\n", a, b,
+                       delta);
             }
+
+            touched[0] = a;
+            touched[1] = an;
+            touched[2] = b;
+            touched[3] = bn;
+            return delta;
         }
     }
 
-    return deltabest;
+    return 0.0;
+}
+
+double oropt_delta(instance inst, tour t, int s1, int s2, int l,
+                   int reversed) {
+    /* segment s1..s2 moves between l and its successor r */
+    int p = tour_prev(t, s1), nx = tour_next(t, s2), r = tour_next(t, l);
+
+    double removed = dist(p, s1, inst) + dist(s2, nx, inst) + dist(l, r, inst);
+    double added = dist(p, nx, inst);
+    if (reversed)
+        added += dist(l, s2, inst) + dist(s1, r, inst);
+    else
+        added += dist(l, s1, inst) + dist(s2, r, inst);
+
+    return added - removed;
 }
 
-double twoopt_tabu_pick(instance inst, int* succ, int* tabu_nodes, int tenure,
-                        int k, int* a, int* b) {
+void oropt_move(tour t, int s1, int s2, int l, int reversed) {
+    /* p s1..s2 nx ~> l r becomes p nx ~> l s1..s2 r, or l s2..s1 r */
+    tour_make3opt(t, tour_prev(t, s1), s2, l, reversed ? 2 : 1);
+}
+
+double oropt_refinement(instance inst, int* succ, int nnodes,
+                        struct timespec* s, struct timespec* e) {
     assert(inst != NULL);
-    int nnodes, nedges;
-    nnodes = nedges = inst->nnodes;
+    assert(succ != NULL);
 
-    double deltabest;
-    deltabest = INF; /* select also positive delta */
-    *a = *b = 0;
-    for (int i = 0; i < nnodes; i++) {
-        if (k <= tabu_nodes[i] + tenure) continue;
-        for (int j = i + 1; j < nnodes; j++) {
-            if (k <= tabu_nodes[j] + tenure) continue;
-            if (succ[i] == j || succ[j] == i) continue;
+    double improvement = 0.0;
 
-            double delta = twoopt_delta(inst, succ, i, j);
+    /* need room for the segment, its ends and one more edge */
+    if (nnodes < OROPT_MAXLEN + 4) return improvement;
 
-            if (delta < deltabest) {
-                deltabest = delta;
-                *a = i;
-                *b = j;
+    build_candidates(inst);
+    candidates c = inst->cands;
+
+    tour t = tour_from_succ(succ, nnodes);
+
+    int* queue = (int*)malloc(nnodes * sizeof(int));
+    char* inqueue = (char*)calloc(nnodes, sizeof(char));
+    int head = 0, tail = 0, size = 0;
+    for (int i = 0, v = 0; i < nnodes; i++, v = tour_next(t, v)) {
+        dlb_push(queue, inqueue, nnodes, &tail, v);
+        size++;
+    }
+
+    int touched[6];
+    while (size > 0 && stopwatch(s, e) / 1000.0 < inst->params->timelimit) {
+        int a = queue[head];
+        head = (head + 1) % nnodes;
+        inqueue[a] = 0;
+        size--;
+
+        double delta = oropt_neighbor_move(inst, t, c, a, touched);
+        if (delta > -EPSILON) continue;
+
+        improvement += delta;
+
+        for (int i = 0; i < 6; i++) {
+            if (inqueue[touched[i]]) continue;
+            dlb_push(queue, inqueue, nnodes, &tail, touched[i]);
+            size++;
+        }
+    }
+
+    tour_to_succ(t, succ);
+
+    tour_free(t);
+    free(queue);
+    free(inqueue);
+
+    return improvement;
+}
+
+double oropt_neighbor_move(instance inst, tour t, candidates c, int a,
+                           int* touched) {
+    int* list = candidates_list(c, a);
+    int ncands = candidates_size(c, a);
+
+    /* segments of 1 to OROPT_MAXLEN nodes with a at one end */
+    for (int len = 1; len <= OROPT_MAXLEN; len++) {
+        for (int dir = 0; dir < 2; dir++) {
+            if (len == 1 && dir == 1) break;
+
+            int s1, s2;
+            oropt_segment(t, a, len, dir, &s1, &s2);
+            int p = tour_prev(t, s1), nx = tour_next(t, s2);
+
+            /* gain of taking the segment out */
+            double gain =
+                dist(p, s1, inst) + dist(s2, nx, inst) - dist(p, nx, inst);
+            if (gain < EPSILON) continue;
+
+            for (int k = 0; k < ncands; k++) {
+                int b = list[k];
+
+                /* a new edge (a, b) longer than the gain hardly pays */
+                if (dist(a, b, inst) >= gain) break;
+
+                /* insert between b and either of its tour neighbors */
+                int ls[2] = {b, tour_prev(t, b)};
+                for (int h = 0; h < 2; h++) {
+                    int l = ls[h];
+                    if (l == p || tour_between(t, s1, l, s2)) continue;
+
+                    int reversed = 0;
+                    double delta = oropt_delta(inst, t, s1, s2, l, 0);
+                    double rdelta = oropt_delta(inst, t, s1, s2, l, 1);
+                    if (rdelta < delta) {
+                        delta = rdelta;
+                        reversed = 1;
+                    }
+                    if (delta > -EPSILON) continue;
+
+                    int r = tour_next(t, l);
+                    oropt_move(t, s1, s2, l, reversed);
+
+                    if (EXTRA_VERBOSE) {
+                        printf("[VERBOSE] oropt %d..%d after %d delta %lf\n",
+                               s1, s2, l, delta);
+                    }
+
+                    touched[0] = p;
+                    touched[1] = nx;
+                    touched[2] = s1;
+                    touched[3] = s2;
+                    touched[4] = l;
+                    touched[5] = r;
+                    return delta;
+                }
             }
         }
     }
 
-    return deltabest;
+    return 0.0;
 }
 
-void twoopt_move(int* succ, int nnodes, int a, int b) {
-    int aprime = succ[a], bprime = succ[b];
+void oropt_segment(tour t, int a, int len, int dir, int* s1, int* s2) {
+    /* forward segment of len nodes starting (dir 0) or ending (dir 1) in a */
+    int v = a;
+    for (int i = 1; i < len; i++) {
+        v = dir == 0 ? tour_next(t, v) : tour_prev(t, v);
+    }
 
-    /* b -> b' becomes b ~-> a' */
-    reverse_path(succ, nnodes, aprime, b);
-    /* a -> a' becomes a -> b */
-    succ[a] = b;
-    /* a' ~-> b becomes a' -> b' */
-    succ[aprime] = bprime;
-    /* b' ~-> a remains untouched */
-    {}
+    *s1 = dir == 0 ? a : v;
+    *s2 = dir == 0 ? v : a;
 }
 
-double threeopt_refinement(instance inst, int* succ, int nnodes,
-                           struct timespec* s, struct timespec* e) {
+double refine(instance inst, int* succ, int nnodes, struct timespec* s,
+              struct timespec* e) {
+    assert(inst != NULL);
+    assert(inst->params != NULL);
+
+    switch (inst->params->refinement_type) {
+        case TWOOPT_REFINEMENT:
+            return twoopt_refinement(inst, succ, nnodes, s, e);
+        case TWOOPT_NEIGHBOR_REFINEMENT:
+            return twoopt_neighbor_refinement(inst, succ, nnodes, s, e);
+        case OROPT_REFINEMENT: {
+            /* alternate the two neighborhoods until neither improves */
+            double improvement = 0.0, delta;
+            do {
+                improvement +=
+                    twoopt_neighbor_refinement(inst, succ, nnodes, s, e);
+                delta = oropt_refinement(inst, succ, nnodes, s, e);
+                improvement += delta;
+            } while (delta < -EPSILON &&
+                     stopwatch(s, e) / 1000.0 < inst->params->timelimit);
+
+            return improvement;
+        }
+        case LK_REFINEMENT:
+            return lk_refinement(inst, succ, nnodes, s, e);
+    }
+
+    return 0.0; /* warning suppressor */
+}
+
+localsearch localsearch_create(instance inst, int* succ) {
+    assert(inst != NULL);
+    assert(succ != NULL);
+
+    int nnodes = inst->nnodes;
+    build_candidates(inst);
+
+    localsearch ls = (localsearch)calloc(1, sizeof(struct localsearch_t));
+    ls->inst = inst;
+    ls->c = inst->cands;
+    ls->t = tour_from_succ(succ, nnodes);
+
+    /* don't look bits queue, empty: refine_from fills it with its seeds */
+    ls->queue = (int*)malloc(nnodes * sizeof(int));
+    ls->inqueue = (char*)calloc(nnodes, sizeof(char));
+
+    if (inst->params->refinement_type == LK_REFINEMENT) {
+        ls->lk = (lksearch)calloc(1, sizeof(struct lksearch_t));
+        ls->lk->inst = inst;
+        ls->lk->c = ls->c;
+        ls->lk->t = ls->t;
+    }
+
+    return ls;
+}
+
+void localsearch_free(localsearch ls) {
+    if (ls == NULL) return;
+
+    tour_free(ls->t);
+    free(ls->queue);
+    free(ls->inqueue);
+    free(ls->lk);
+
+    free(ls);
+}
+
+double refine_from(localsearch ls, int* seeds, int nseeds, struct timespec* s,
+                   struct timespec* e) {
+    assert(ls != NULL);
+    assert(seeds != NULL);
+
+    instance inst = ls->inst;
+    tour t = ls->t;
+    candidates c = ls->c;
+    int nnodes = t->nnodes;
+
     double improvement = 0.0;
+    if (nnodes < 8) return improvement;
 
-    int a, b, c;
-    double delta = 1.0; /* using 0.0 as sentinel */
-    a = b = c = 0;
+    /* don't look bits: only the seeds are looked at first */
+    for (int i = 0; i < nseeds; i++) {
+        if (ls->inqueue[seeds[i]]) continue;
+        dlb_push(ls->queue, ls->inqueue, nnodes, &ls->tail, seeds[i]);
+        ls->size++;
+    }
 
-    /* iterate over 2opt moves until not improvable */
-    while (stopwatch(s, e) / 1000.0 < inst->params->timelimit &&
-           (delta = threeopt_pick(inst, succ, &a, &b, &c, s, e)) != 0.0) {
-        if (EXTRA_VERBOSE) {
-            printf("[VERBOSE] refinement on %d, %d, %d delta %lf\n", a, b, c,
-                   delta);
+    int buffer[6];
+    while (ls->size > 0 &&
+           stopwatch(s, e) / 1000.0 < inst->params->timelimit) {
+        int a = ls->queue[ls->head];
+        ls->head = (ls->head + 1) % nnodes;
+        ls->inqueue[a] = 0;
+        ls->size--;
+
+        /* the full 2opt scan has no local version: its neighbor lists one
+         * takes its place */
+        double delta = 0.0;
+        int* touched = buffer;
+        int ntouched = 0;
+        switch (inst->params->refinement_type) {
+            case TWOOPT_REFINEMENT:
+            case TWOOPT_NEIGHBOR_REFINEMENT:
+                delta = twoopt_neighbor_move(inst, t, c, a, touched);
+                ntouched = 4;
+                break;
+            case OROPT_REFINEMENT:
+                delta = twoopt_neighbor_move(inst, t, c, a, touched);
+                ntouched = 4;
+                if (delta > -EPSILON) {
+                    delta = oropt_neighbor_move(inst, t, c, a, touched);
+                    ntouched = 6;
+                }
+                break;
+            case LK_REFINEMENT:
+                delta = lk_move(ls->lk, a);
+                touched = ls->lk->flips;
+                ntouched = 4 * ls->lk->depth;
+                break;
         }
-        printf("time: %ld\n", stopwatch(s, e) / 1000);
+        if (delta > -EPSILON) continue;
 
-        /* actually perform the move */
-        threeopt_move(succ, nnodes, a, b, c, inst);
+        improvement += delta;
 
-        /* update the objective */
-        improvement += delta; /* delta should be negative */
+        for (int i = 0; i < ntouched; i++) {
+            if (ls->inqueue[touched[i]]) continue;
+            dlb_push(ls->queue, ls->inqueue, nnodes, &ls->tail, touched[i]);
+            ls->size++;
+        }
     }
 
     return improvement;
 }
 
-double threeopt_pick(instance inst, int* succ, int* a, int* b, int* c,
-                     struct timespec* s, struct timespec* e) {
+double twoopt_pick(instance inst, int* succ, double* dsucc, int* a, int* b) {
     assert(inst != NULL);
+    assert(dsucc != NULL);
     int nnodes, nedges;
     nnodes = nedges = inst->nnodes;
 
     double deltabest;
-    deltabest = 0.0;
-    *a = *b = *c = 0;
+    deltabest = 0.0; /* select also positive delta */
+    *a = *b = 0;
 
-    int timelimit_reached = 0;
-    for (int i = 0; i < nnodes; i++) {
-        if (timelimit_reached) break;
-        for (int j = i + 1; j < nnodes; j++) {
-            if (timelimit_reached) break;
-            for (int k = j + 1; k < nnodes; k++) {
-                if (i == succ[j] || i == succ[k]) continue;
-                if (j == succ[i] || j == succ[k]) continue;
-                if (k == succ[i] || k == succ[j]) continue;
-
-                if (stopwatch(s, e) / 1000.0 > inst->params->timelimit) {
-                    timelimit_reached = 1;
-                    break;
-                }
+    /* length of each tour edge, shared by the threads */
+#pragma omp parallel for num_threads(heuristic_threads(inst))
+    for (int i = 0; i < nnodes; i++) dsucc[i] = dist(i, succ[i], inst);
+
+    int fast = twoopt_row_fast(inst);
+
+#pragma omp parallel num_threads(heuristic_threads(inst))
+    {
+        /* twoopt_delta unrolled on batch distances: rows of i and succ[i],
+         * same operations order */
+        double* rowi = NULL;
+        double* rowsucci = NULL;
+        if (!fast) {
+            rowi = (double*)malloc(nnodes * sizeof(double));
+            rowsucci = (double*)malloc(nnodes * sizeof(double));
+        }
 
-                double delta[4];
-                for (int n = 0; n < 4; n++)
-                    delta[n] =
-                        -(dist(i, succ[i], inst) + dist(j, succ[j], inst) +
-                          dist(k, succ[k], inst));
-
-                int g = i;
-                int swap = 0;
-                int tj, tk;
-
-                // makes k the third visited node
-                while (succ[g] != i) {
-                    if (swap == 0) {
-                        if (succ[g] == k) swap = 1;
-                        if (succ[g] == j) swap = -1;
-                    }
-                    g = succ[g];
+        /* each thread gets its chunks of i in increasing order: its best is
+         * the first one in (i, j) order among the ones it saw */
+        double tbest = 0.0;
+        int ta = 0, tb = 0;
+
+#pragma omp for schedule(dynamic, 16) nowait
+        for (int i = 0; i < nnodes; i++) {
+            /* no distance matrix: the whole row in a vector kernel */
+            if (fast) {
+                int j;
+                double delta = twoopt_row_best(inst, succ, dsucc, NULL, i,
+                                               i + 1, nnodes - i - 1, &j);
+                if (delta < tbest) {
+                    tbest = delta;
+                    ta = i;
+                    tb = j;
                 }
+                continue;
+            }
 
-                if (swap == 1) {
-                    tk = j;
-                    tj = k;
-                } else {
-                    tj = j;
-                    tk = k;
-                }
+            dist_row(inst, i, i + 1, nnodes - i - 1, rowi);
+            dist_row(inst, succ[i], 0, nnodes, rowsucci);
 
-                // 5 cases: preserving cases reducing to 2-opt and subtours
-                delta[0] += dist(i, tj, inst) + dist(succ[i], tk, inst) +
-                            dist(succ[tj], succ[tk],
-                                 inst);  // i, j, succ[i], k, succ[j], succ[k]
-                delta[1] += dist(i, succ[tj], inst) + dist(tk, succ[i], inst) +
-                            dist(tj, succ[tk],
-                                 inst);  // i, succ[j], k, succ[i], j, succ[k]
-                delta[2] += dist(i, succ[tj], inst) + dist(tk, tj, inst) +
-                            dist(succ[i], succ[tk],
-                                 inst);  // i, succ[j], k, j, succ[i], succ[k]
-                delta[3] += dist(i, tk, inst) + dist(succ[tj], succ[i], inst) +
-                            dist(tj, succ[tk],
-                                 inst);  // i, k, succ[j], succ[i], j, succ[k]
-
-                for (int n = 0; n < 4; n++)
-                    if (delta[n] < deltabest) {
-                        deltabest = delta[n];
-                        *a = i;
-                        *b = tj;
-                        *c = tk;
-                    }
+            for (int j = i + 1; j < nnodes; j++) {
+                double delta = rowi[j - i - 1] + rowsucci[succ[j]] -
+                               (dsucc[i] + dsucc[j]);
+
+                if (delta < tbest) {
+                    tbest = delta;
+                    ta = i;
+                    tb = j;
+                }
             }
         }
+
+        /* ties go to the smallest (i, j), as in the sequential scan */
+#pragma omp critical
+        if (tbest < 0.0) twoopt_reduce(tbest, ta, tb, &deltabest, a, b);
+
+        free(rowi);
+        free(rowsucci);
     }
 
     return deltabest;
 }
 
-void threeopt_move(int* succ, int nnodes, int a, int b, int c, instance inst) {
-    int aprime = succ[a], bprime = succ[b], cprime = succ[c];
+void twoopt_reduce(double delta, int i, int j, double* deltabest, int* a,
+                   int* b) {
+    if (delta > *deltabest) return;
+    if (delta == *deltabest && (*a < i || (*a == i && *b < j))) return;
 
-    double delta[4];
-
-    int index = 0;
+    *deltabest = delta;
+    *a = i;
+    *b = j;
+}
 
-    delta[0] =
-        dist(a, b, inst) + dist(succ[a], c, inst) +
-        dist(succ[b], succ[c], inst);  // i, j, succ[i], k, succ[j], succ[k]
-    delta[1] = dist(a, succ[b], inst) + dist(c, succ[a], inst) +
-               dist(b, succ[c], inst);  // i, succ[j], k, succ[i], j, succ[k]
-    delta[2] =
-        dist(a, succ[b], inst) + dist(c, b, inst) +
-        dist(succ[a], succ[c], inst);  // i, succ[j], k, j, succ[i], succ[k]
-    delta[3] = dist(a, c, inst) + dist(succ[b], succ[a], inst) +
-               dist(b, succ[c], inst);  // i, k, succ[j], succ[i], j, succ[k]
+void twoopt_move(int* succ, int nnodes, int a, int b) {
+    int aprime = succ[a], bprime = succ[b];
 
-    double best = delta[0];
+    /* b -> b' becomes b ~-> a' */
+    reverse_path(succ, nnodes, aprime, b);
+    /* a -> a' becomes a -> b */
+    succ[a] = b;
+    /* a' ~-> b becomes a' -> b' */
+    succ[aprime] = bprime;
+    /* b' ~-> a remains untouched */
+    {}
+}
 
-    for (int n = 1; n < 4; n++)
-        if (delta[n] < best) {
-            best = delta[n];
-            index = n;
-        }
+twoopt_cache twoopt_cache_create(instance inst, int* succ, int noadjacent) {
+    assert(inst != NULL);
+    assert(succ != NULL);
 
-    best = best - (dist(a, succ[a], inst) + dist(b, succ[b], inst) +
-                   dist(c, succ[c], inst));
+    int nnodes = inst->nnodes;
 
-    // if necessary swap tour from aprime to b
-    if (index == 0 || index == 2) {
-        /* b -> b' becomes b ~-> a' */
-        int* stack = (int*)malloc(nnodes * sizeof(int));
-        int k = 0;
+    twoopt_cache tc = (twoopt_cache)calloc(1, sizeof(struct twoopt_cache_t));
+    tc->nnodes = nnodes;
+    tc->noadjacent = noadjacent;
+    tc->dsucc = (double*)malloc(nnodes * sizeof(double));
+    tc->pred = (int*)malloc(nnodes * sizeof(int));
+    tc->penalty = (double*)calloc(nnodes, sizeof(double));
+    tc->delta = (double*)malloc(nnodes * sizeof(double));
+    tc->partner = (int*)malloc(nnodes * sizeof(int));
+    tc->changed = (int*)malloc(nnodes * sizeof(int));
+    tc->ischanged = (char*)calloc(nnodes, sizeof(char));
 
-        stack[0] = aprime;
-        k++;
+    for (int i = 0; i < nnodes; i++) {
+        tc->dsucc[i] = dist(i, succ[i], inst);
+        tc->pred[succ[i]] = i;
+    }
 
-        while (stack[k - 1] != b) {
-            stack[k] = succ[stack[k - 1]];
-            k++;
-        }
+#pragma omp parallel for schedule(dynamic, 16) \
+    num_threads(heuristic_threads(inst))
+    for (int i = 0; i < nnodes; i++) twoopt_cache_row(tc, inst, succ, i);
 
-        k--;
-        while (k >= 1) {
-            succ[stack[k]] = stack[k - 1];
-            k--;
-        }
+    return tc;
+}
 
-        free(stack);
-    }
+void twoopt_cache_free(twoopt_cache tc) {
+    if (tc == NULL) return;
 
-    // if necessary swap tour from bprime to c
-    if (index == 0 || index == 3) {
-        /* b -> b' becomes b ~-> a' */
-        int* stack = (int*)malloc(nnodes * sizeof(int));
-        int k = 0;
+    free(tc->dsucc);
+    free(tc->pred);
+    free(tc->penalty);
+    free(tc->delta);
+    free(tc->partner);
+    free(tc->changed);
+    free(tc->ischanged);
 
-        stack[0] = bprime;
-        k++;
+    free(tc);
+}
 
-        while (stack[k - 1] != c) {
-            stack[k] = succ[stack[k - 1]];
-            k++;
-        }
+double twoopt_cache_pick(twoopt_cache tc, int* a, int* b) {
+    /* same move of the full scan: smallest delta, then smallest (i, j) */
+    double deltabest = INFINITY;
+    *a = *b = 0;
 
-        k--;
-        while (k >= 1) {
-            succ[stack[k]] = stack[k - 1];
-            k--;
+    for (int i = 0; i < tc->nnodes; i++) {
+        if (tc->delta[i] < deltabest) {
+            deltabest = tc->delta[i];
+            *a = i;
+            *b = tc->partner[i];
         }
-        free(stack);
     }
 
-    if (index == 0) {
-        succ[a] = b;
-        succ[aprime] = c;
-        succ[bprime] = cprime;
-    }
-    if (index == 1) {
-        succ[a] = bprime;
-        succ[c] = aprime;
-        succ[b] = cprime;
+    return deltabest;
+}
+
+void twoopt_cache_move(twoopt_cache tc, instance inst, int* succ, int a,
+                       int b) {
+    /* either side can be reversed: walk both at once and take the shorter,
+     * a' ~-> b reversed by twoopt_move(a, b), b' ~-> a by twoopt_move(b, a) */
+    int u = succ[a], v = succ[b];
+    while (u != b && v != a) {
+        u = succ[u];
+        v = succ[v];
     }
-    if (index == 2) {
-        succ[a] = bprime;
-        succ[c] = b;
-        succ[aprime] = cprime;
+    if (u != b) {
+        int t = a;
+        a = b;
+        b = t;
     }
-    if (index == 3) {
-        succ[a] = c;
-        succ[bprime] = aprime;
-        succ[b] = cprime;
+
+    int nchanged = 0;
+    tc->changed[nchanged++] = a;
+    for (int x = succ[a];; x = succ[x]) {
+        tc->changed[nchanged++] = x;
+        if (x == b) break;
     }
-}
 
-void kick(int* succ, int nnodes, int strength) {
-    assert(strength >= 2);
-    assert(strength < nnodes / 2);
+    twoopt_move(succ, tc->nnodes, a, b);
 
-    /* tbh the worse line of code ive ever written */
+    for (int k = 0; k < nchanged; k++) {
+        int x = tc->changed[k];
+        tc->dsucc[x] = dist(x, succ[x], inst);
+        tc->pred[succ[x]] = x;
+    }
 
-    srand(time(NULL));
-    unsigned int seedp = time(NULL);
+    twoopt_cache_update(tc, inst, succ, nchanged);
+}
 
-    /* phase 1: embedded successor array preparation */
-    int embsize = 2 * strength; /* embedded size */
+void twoopt_cache_allow(twoopt_cache tc, instance inst, int* succ,
+                        char* allowed) {
+    int nchanged = 0;
+    for (int x = 0; x < tc->nnodes; x++) {
+        if (allowed[x] == (tc->penalty[x] == 0.0)) continue;
 
-    int nselected = 0;
-    int* selected = (int*)malloc(strength * sizeof(int));
-    while (nselected < strength) {
-        int candidate = rand_r(&seedp) % nnodes;
+        tc->penalty[x] = allowed[x] ? 0.0 : INFINITY;
+        tc->changed[nchanged++] = x;
+    }
 
-        /* check if not previously selected or is at dist 1 from it */
-        int valid = 1;
-        for (int i = 0; i < nselected; i++) {
-            if (candidate == selected[i] || candidate == succ[selected[i]] ||
-                succ[candidate] == selected[i]) {
-                valid = 0;
-                break;
+    if (nchanged > 0) twoopt_cache_update(tc, inst, succ, nchanged);
+}
+
+void twoopt_cache_update(twoopt_cache tc, instance inst, int* succ,
+                         int nchanged) {
+    for (int k = 0; k < nchanged; k++) tc->ischanged[tc->changed[k]] = 1;
+
+#pragma omp parallel for schedule(dynamic, 16) \
+    num_threads(heuristic_threads(inst))
+    for (int i = 0; i < tc->nnodes; i++) {
+        int p = tc->partner[i];
+        if (tc->ischanged[i] || (p >= 0 && tc->ischanged[p])) {
+            twoopt_cache_row(tc, inst, succ, i);
+            continue;
+        }
+        if (tc->penalty[i] != 0.0) continue;
+
+        /* the best among the unchanged pairs is still there */
+        for (int k = 0; k < nchanged; k++) {
+            int x = tc->changed[k];
+            if (x <= i || tc->penalty[x] != 0.0) continue;
+            if (tc->noadjacent && (succ[i] == x || succ[x] == i)) continue;
+
+            double delta = dist(i, x, inst) + dist(succ[i], succ[x], inst) -
+                           (tc->dsucc[i] + tc->dsucc[x]);
+            if (delta < tc->delta[i] ||
+                (delta == tc->delta[i] && x < tc->partner[i])) {
+                tc->delta[i] = delta;
+                tc->partner[i] = x;
             }
         }
+    }
+
+    for (int k = 0; k < nchanged; k++) tc->ischanged[tc->changed[k]] = 0;
+}
 
-        if (valid) {
-            selected[nselected] = candidate;
-            nselected++;
+void twoopt_cache_row(twoopt_cache tc, instance inst, int* succ, int i) {
+    int nnodes = tc->nnodes;
+
+    tc->delta[i] = INFINITY;
+    tc->partner[i] = -1;
+    if (tc->penalty[i] != 0.0) return;
+
+    /* adjacent nodes split the row in up to three ranges */
+    int cut[3] = {nnodes, nnodes, nnodes};
+    if (tc->noadjacent) {
+        int s = succ[i], p = tc->pred[i];
+        cut[0] = s > i ? s : nnodes;
+        cut[1] = p > i ? p : nnodes;
+        if (cut[0] > cut[1]) {
+            int t = cut[0];
+            cut[0] = cut[1];
+            cut[1] = t;
         }
     }
-    /* sort cause with reverses we're going to do a mess */
-    int* pathlenghts = (int*)malloc(nnodes * sizeof(int));
-    for (int i = 0; i < nselected; i++) {
-        pathlenghts[selected[i]] = reachable(succ, 0, selected[i]);
-    }
-    qsort_r(selected, strength, sizeof(int), pathcmp, pathlenghts);
-
-    /* with the nodes ordered, we can finally map nodes with successors to real
-     * tour and delete the arcs from real tour */
-    int* map = (int*)malloc(embsize * sizeof(int));
-    for (int i = 0; i < nselected; i++) {
-        /* even -> node, next odd -> its successor */
-        map[2 * i] = selected[i];
-        map[2 * i + 1] = succ[selected[i]];
 
-        /* delete arcs in the real one */
-        succ[selected[i]] = -1;
+    int first = i + 1;
+    for (int c = 0; c < 3 && first < nnodes; c++) {
+        int j;
+        double delta = twoopt_row_best(inst, succ, tc->dsucc, tc->penalty, i,
+                                       first, cut[c] - first, &j);
+        if (delta < tc->delta[i]) {
+            tc->delta[i] = delta;
+            tc->partner[i] = j;
+        }
+        first = cut[c] + 1;
     }
+}
 
-    /* finally, create the embedding */
-    int* embsucc = (int*)malloc(embsize * sizeof(int));
-    for (int i = 0; i < embsize; i++) embsucc[i] = -1;
+double threeopt_refinement(instance inst, int* succ, int nnodes,
+                           struct timespec* s, struct timespec* e) {
+    assert(inst != NULL);
+    assert(succ != NULL);
+
+    double improvement = 0.0;
+    if (nnodes < 8) return improvement;
 
-    /* to determine the target node while creating an arc, we have to be sure to
-     * not create subtours (uf) and that the node is an actual target (relative
-     * array) */
-    union_find uf = uf_create(embsize);
-    int* target = (int*)malloc(2 * strength * sizeof(int));
-    for (int i = 0; i < embsize; i++) target[i] = 1; /* anyone is a target */
+    build_candidates(inst);
+    candidates c = inst->cands;
 
-    /* set path sucecssor */
-    for (int i = 0; i < 2 * strength; i++) {
-        if (i % 2 != 1) continue; /* target odd position */
+    tour t = tour_from_succ(succ, nnodes);
 
-        embsucc[i] = (i + 1) % embsize;
-        uf_union_set(uf, i, (i + 1) % embsize);
+    /* same don't look bits queue of the neighbor 2opt */
+    int* queue = (int*)malloc(nnodes * sizeof(int));
+    char* inqueue = (char*)calloc(nnodes, sizeof(char));
+    int head = 0, tail = 0, size = 0;
+    for (int i = 0, v = 0; i < nnodes; i++, v = tour_next(t, v)) {
+        dlb_push(queue, inqueue, nnodes, &tail, v);
+        size++;
     }
 
-    /* phase2: arc creation */
-    int* buffer = (int*)malloc(embsize * sizeof(int));
-    int tofix = strength;
-    while (tofix--) { /* one arc creation for iteration */
-        int a, b;
-        int k;
+    int touched[6];
+    while (size > 0 && stopwatch(s, e) / 1000.0 < inst->params->timelimit) {
+        int a = queue[head];
+        head = (head + 1) % nnodes;
+        inqueue[a] = 0;
+        size--;
 
-        /* store in a buffer the legal starting nodes for a new arc */
-        k = 0;
-        for (int i = 0; i < embsize; i++) {
-            if (embsucc[i] != -1) continue; /* legal == not a successor */
+        double delta = threeopt_neighbor_move(inst, t, c, a, touched);
+        if (delta > -EPSILON) continue;
 
-            buffer[k] = i;
-            k++;
-        }
-        a = buffer[rand() % k];
-        target[a] = 0; /* x cannot be targeted now */
-
-        /* store in a buffer the legal ending position: we have to check that is
-         * is a valid target and it's path is not the same as x */
-        k = 0;
-        for (int i = 0; i < embsize; i++) {
-            /* in the last iteration there's clearly a single path */
-            if (tofix != 0 && uf_same_set(uf, a, i)) continue;
-            if (!target[i]) continue;
-
-            buffer[k] = i;
-            k++;
-        }
-        b = buffer[rand() % k];
-        target[b] = 0;
+        improvement += delta;
 
-        if (EXTRA_VERBOSE) {
-            printf("[VERBOSE] random selected %d(%d) -> %d(%d)\n", map[a] + 1,
-                   a, map[a] + 1, b);
+        for (int i = 0; i < 6; i++) {
+            if (inqueue[touched[i]]) continue;
+            dlb_push(queue, inqueue, nnodes, &tail, touched[i]);
+            size++;
         }
+    }
 
-        /* if b has not a successor, it means that we have to reverse the path
-         * from a node u to b, but first we have to find this node u, the other
-         * loose end of the path */
+    tour_to_succ(t, succ);
 
-        if (embsucc[b] == -1) {
-            int u;
+    tour_free(t);
+    free(queue);
+    free(inqueue);
 
-            /* pick the fartherst node from b */
-            int maxpathlen = 0;
-            for (int i = 0; i < embsize; i++) {
-                if (!uf_same_set(uf, b, i)) continue;
+    return improvement;
+}
 
-                int pathlen =
-                    max(reachable(embsucc, b, i), reachable(embsucc, i, b));
+double threeopt_neighbor_move(instance inst, tour t, candidates c, int t1,
+                              int* touched) {
+    /* sequential search: (t1, t2), (t3, t4), (t5, t6) are removed and
+     * (t2, t3), (t4, t5), (t6, t1) added, the partial gain must stay positive
+     * and the candidate lists are sorted so the scans stop early. A depth 2
+     * closure (t4, t1) is taken when it is a valid 2opt move */
+    for (int d2 = 0; d2 < 2; d2++) {
+        int t2 = d2 == 0 ? tour_next(t, t1) : tour_prev(t, t1);
+        double d12 = dist(t1, t2, inst);
+
+        int* list2 = candidates_list(c, t2);
+        int n2 = candidates_size(c, t2);
+        for (int k2 = 0; k2 < n2; k2++) {
+            int t3 = list2[k2];
+            double g1 = d12 - dist(t2, t3, inst);
+            if (g1 <= EPSILON) break;
+            if (t3 == t1) continue;
+
+            for (int d4 = 0; d4 < 2; d4++) {
+                int t4 = d4 == 0 ? tour_next(t, t3) : tour_prev(t, t3);
+                if (t4 == t2) continue;
+                double g2 = g1 + dist(t3, t4, inst);
+
+                /* close with a 2opt move when the directions agree */
+                if (d2 != d4 && t4 != t1) {
+                    double delta = dist(t4, t1, inst) - g2;
+                    if (delta < -EPSILON) {
+                        tour_make2opt(t, t2, t1, t3, t4);
+
+                        touched[0] = touched[4] = t1;
+                        touched[1] = touched[5] = t2;
+                        touched[2] = t3;
+                        touched[3] = t4;
+                        return delta;
+                    }
+                }
 
-                if (pathlen > maxpathlen) {
-                    maxpathlen = pathlen;
-                    u = i;
+                int* list4 = candidates_list(c, t4);
+                int n4 = candidates_size(c, t4);
+                for (int k4 = 0; k4 < n4; k4++) {
+                    int t5 = list4[k4];
+                    double g3 = g2 - dist(t4, t5, inst);
+                    if (g3 <= EPSILON) break;
+
+                    for (int d6 = 0; d6 < 2; d6++) {
+                        int t6 = d6 == 0 ? tour_next(t, t5) : tour_prev(t, t5);
+                        if (t6 == t1) continue;
+
+                        double delta = dist(t6, t1, inst) - dist(t5, t6, inst) -
+                                       g3;
+                        if (delta > -EPSILON) continue;
+
+                        int a, b, cc;
+                        int rc = threeopt_reconnection(t, t1, t2, t3, t4, t5,
+                                                       t6, &a, &b, &cc);
+                        if (rc < 0) continue;
+
+                        if (EXTRA_VERBOSE) {
+                            printf("[VERBOSE] refinement on %d, %d, %d "
+                                   "delta %lf\n",
+                                   a, b, cc, delta);
+                        }
+
+                        tour_make3opt(t, a, b, cc, rc);
+
+                        touched[0] = t1;
+                        touched[1] = t2;
+                        touched[2] = t3;
+                        touched[3] = t4;
+                        touched[4] = t5;
+                        touched[5] = t6;
+                        return delta;
+                    }
                 }
             }
+        }
+    }
 
-            if (VERBOSE)
-                printf("[VERBOSE] perform reverse %d(%d) ~-> %d(%d)\n",
-                       map[u] + 1, u, map[b] + 1, b);
+    return 0.0;
+}
 
-            /* u becomes a loose end (in opposite direction) */
-            reverse_path(embsucc, embsize, u, b);
-            embsucc[u] = -1;
-            target[u] = 1;
+int threeopt_reconnection(tour t, int t1, int t2, int t3, int t4, int t5,
+                          int t6, int* a, int* b, int* c) {
+    /* tails of the removed edges in the current orientation */
+    int u1 = tour_next(t, t1) == t2 ? t1 : t2;
+    int u2 = tour_next(t, t3) == t4 ? t3 : t4;
+    int u3 = tour_next(t, t5) == t6 ? t5 : t6;
+    if (u1 == u2 || u1 == u3 || u2 == u3) return -1;
+
+    /* a, b, c in forward order */
+    *a = u1;
+    if (tour_between(t, tour_next(t, u1), u2, u3)) {
+        *b = u2;
+        *c = u3;
+    } else {
+        *b = u3;
+        *c = u2;
+    }
 
-            reverse_path(succ, nnodes, map[u], map[b]);
-            succ[map[u]] = -1;
+    int ap = tour_next(t, *a), bp = tour_next(t, *b), cp = tour_next(t, *c);
+
+    /* added edges of the four cases handled by tour_make3opt */
+    int cases[4][6] = {{*a, *b, ap, *c, bp, cp},
+                       {*a, bp, *c, ap, *b, cp},
+                       {*a, bp, *c, *b, ap, cp},
+                       {*a, *c, bp, ap, *b, cp}};
+    int added[6] = {t2, t3, t4, t5, t6, t1};
+
+    for (int rc = 0; rc < 4; rc++) {
+        int found = 0;
+        for (int i = 0; i < 3; i++) {
+            int x = cases[rc][2 * i], y = cases[rc][2 * i + 1];
+            for (int j = 0; j < 3; j++) {
+                int u = added[2 * j], v = added[2 * j + 1];
+                if ((u == x && v == y) || (u == y && v == x)) {
+                    found++;
+                    break;
+                }
+            }
         }
+        if (found == 3) return rc;
+    }
+
+    /* the reconnection would split the tour */
+    return -1;
+}
 
-        /* create the new arc: set both embedded and real successor array and
-         * update the union find data structure */
-        embsucc[a] = b;
-        uf_union_set(uf, a, b);
-        succ[map[a]] = map[b];
-    }
-
-    /* *looking at the heap as being vito corleone* look how they massacred my
-     * boy*/
-    uf_free(uf);
-    free(pathlenghts);
-    free(selected);
-    free(buffer);
-    free(embsucc);
-    free(map);
+void kick(tour t, int strength, rng* r, int* kicked) {
+    /* segment reversal-free kick: cut strength random tour edges and link
+     * the segments back in a shuffled order, the first one fixed. Segments
+     * keep their orientation, so only strength successors change: with 3
+     * cuts it is the double bridge */
+    int nnodes = t->nnodes;
+    assert(strength >= 3);
+    assert(strength < VNS_K_MAX && strength <= nnodes);
+
+    /* distinct cut edges (v, next v), sorted along the tour from the first */
+    int cut[VNS_K_MAX];
+    for (int i = 0; i < strength; i++) {
+        int v, valid;
+        do {
+            v = rng_int(r, nnodes);
+            valid = 1;
+            for (int j = 0; j < i; j++) valid &= cut[j] != v;
+        } while (!valid);
+
+        int j = i;
+        for (; j > 1 && tour_between(t, cut[0], v, cut[j - 1]); j--) {
+            cut[j] = cut[j - 1];
+        }
+        cut[j] = v;
+    }
+
+    /* segment i goes from first[i] to last[i], cut edges are last -> first */
+    int first[VNS_K_MAX], last[VNS_K_MAX];
+    for (int i = 0; i < strength; i++) {
+        last[i] = cut[i];
+        first[(i + 1) % strength] = tour_next(t, cut[i]);
+    }
+
+    /* shuffle the segments after the first until no cut edge survives */
+    int order[VNS_K_MAX];
+    for (int i = 0; i < strength; i++) order[i] = i;
+    int valid;
+    do {
+        for (int i = strength - 1; i > 1; i--) {
+            int j = 1 + rng_int(r, i);
+            int tmp = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
+        }
+
+        valid = 1;
+        for (int i = 0; i < strength; i++) {
+            int next = order[(i + 1) % strength];
+            valid &= next != (order[i] + 1) % strength;
+        }
+    } while (!valid);
+
+    /* removed edges, then the added ones, for the caller to update the
+     * objective */
+    if (kicked != NULL) {
+        for (int i = 0; i < strength; i++) {
+            kicked[2 * i] = last[i];
+            kicked[2 * i + 1] = first[(i + 1) % strength];
+            kicked[2 * (strength + i)] = last[order[i]];
+            kicked[2 * (strength + i) + 1] = first[order[(i + 1) % strength]];
+        }
+    }
+
+    /* place the segments one by one after the fixed prefix: the wanted one
+     * and the block in between swap places with a pure 3opt move. The moves
+     * may flip the tour orientation, fwd tells how the prefix reads */
+    int tail = last[0], fwd = 1;
+    for (int i = 1; i < strength; i++) {
+        int w = order[i];
+        int next = fwd ? tour_next(t, tail) : tour_prev(t, tail);
+
+        if (next != first[w]) {
+            if (fwd) {
+                /* tail X W c' becomes tail W X c' */
+                tour_make3opt(t, tail, tour_prev(t, first[w]), last[w], 1);
+            } else {
+                /* read forward: a W' X' tail becomes a X' W' tail */
+                tour_make3opt(t, tour_prev(t, last[w]), first[w],
+                              tour_prev(t, tail), 1);
+            }
+        }
+
+        fwd = tour_next(t, tail) == first[w];
+        tail = last[w];
+    }
+
+    if (EXTRA_VERBOSE) {
+        printf("[VERBOSE] kick: %d segments reconnected\n", strength);
+    }
 }
@@ -0,0 +1,44 @@
+#include "../include/rng.h"
+
+#include <assert.h>
+
+/* rotation helper */
+uint64_t rng_rotl(uint64_t x, int k);
+
+void rng_seed(rng* r, int seed, int stream) {
+    /* splitmix64 expands seed and stream in the four words of the state */
+    uint64_t x = (uint64_t)(uint32_t)seed << 32 | (uint32_t)stream;
+
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        r->s[i] = z ^ (z >> 31);
+    }
+}
+
+uint64_t rng_next(rng* r) {
+    uint64_t* s = r->s;
+    uint64_t ans = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+
+    return ans;
+}
+
+int rng_int(rng* r, int n) {
+    assert(n > 0);
+
+    /* multiply and shift on the upper 32 bits instead of a modulo */
+    return (int)(((rng_next(r) >> 32) * (uint64_t)n) >> 32);
+}
+
+double rng_double(rng* r) { return (rng_next(r) >> 11) * 0x1.0p-53; }
+
+uint64_t rng_rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
@@ -3,8 +3,11 @@
 #include <assert.h>
 
 #include "../include/approximations.h"
+#include "../include/candidates.h"
 #include "../include/constructives.h"
+#include "../include/distcache.h"
 #include "../include/globals.h"
+#include "../include/lk.h"
 #include "../include/metaheuristics.h"
 #include "../include/model_builder.h"
 #include "../include/models/benders.h"
@@ -16,7 +19,13 @@ void assert_correctness(solution sol);
 solution TSPopt(instance inst, enum model_types model_type);
 
 solution solve(instance inst, enum model_types model_type) {
-    /* initialize total wall-clock time of execution */
+    /* batch distances layout, opt-in distances cache and candidate lists,
+     * shared by every model on this instance: reported as distance time */
+    build_nodes_soa(inst);
+    double distance_time = build_distcache(inst);
+    distance_time += build_candidates(inst);
+
+    /* initialize total wall-clock time of execution, preprocessing apart */
     struct timespec s, e;
     s.tv_sec = e.tv_sec = -1;
     stopwatch(&s, &e);
@@ -52,7 +61,7 @@ solution solve(instance inst, enum model_types model_type) {
             break;
 
         case GRASP:
-            sol = TSPgrasp(inst, 0);
+            sol = TSPgrasp(inst, 0, NULL);
             break;
 
         case EXTRA_MILEAGE:
@@ -76,7 +85,7 @@ solution solve(instance inst, enum model_types model_type) {
             a.tv_sec = b.tv_sec = -1;
             stopwatch(&a, &b);
 
-            sol = TSPgrasp(inst, 500);
+            sol = TSPgrasp(inst, 500, NULL);
             int* succ = edges_tosucc(sol->edges, sol->nedges);
             free_solution(sol);
 
@@ -99,7 +108,7 @@ solution solve(instance inst, enum model_types model_type) {
             a.tv_sec = b.tv_sec = -1;
             stopwatch(&a, &b);
 
-            sol = TSPgrasp(inst, 500);
+            sol = TSPgrasp(inst, 500, NULL);
             int* succ = edges_tosucc(sol->edges, sol->nedges);
             free_solution(sol);
 
@@ -117,6 +126,10 @@ solution solve(instance inst, enum model_types model_type) {
             sol = TSPgenetic(inst);
             break;
 
+        case LIN_KERNIGHAN:
+            sol = TSPlinkernighan(inst);
+            break;
+
         case OPTIMAL_TOUR:
             sol = NULL;
             assert(model_type != OPTIMAL_TOUR &&
@@ -124,6 +137,7 @@ solution solve(instance inst, enum model_types model_type) {
             break;
     }
     sol->solve_time = stopwatch(&s, &e);
+    sol->distance_time = distance_time;
 
     /* add solution to the pool */
     add_solution(inst, sol);
@@ -311,6 +325,7 @@ solution TSPopt(instance inst, enum model_types model_type) {
         case TABU_SEACH_RANDOM:
         case TABU_SEACH_GRASP:
         case GENETIC:
+        case LIN_KERNIGHAN:
             assert(0 == 1 && "tried to solve a metaheuristic");
             break;
     }
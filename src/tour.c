@@ -0,0 +1,177 @@
+#include "../include/tour.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "../include/globals.h"
+#include "../include/twolevel.h"
+
+/* manipulators */
+tour tour_create(int nnodes) {
+    assert(nnodes > 0);
+
+    tour t = (tour)calloc(1, sizeof(struct tour_t));
+    t->nnodes = nnodes;
+    t->order = (int*)malloc(nnodes * sizeof(int));
+    t->pos = (int*)malloc(nnodes * sizeof(int));
+
+    for (int i = 0; i < nnodes; i++) t->order[i] = t->pos[i] = i;
+
+    return t;
+}
+
+tour tour_from_succ(int* succ, int nnodes) {
+    if (nnodes < TWOLEVEL_MIN_NODES) {
+        tour t = tour_create(nnodes);
+        tour_load_succ(t, succ);
+
+        return t;
+    }
+
+    /* O(sqrt(n)) moves beat the array reversal on large tours */
+    tour t = (tour)calloc(1, sizeof(struct tour_t));
+    t->nnodes = nnodes;
+    t->tl = twolevel_create(succ, nnodes);
+
+    return t;
+}
+
+void tour_load_succ(tour t, int* succ) {
+    assert(succ != NULL);
+    if (t->tl != NULL) {
+        twolevel_load_succ(t->tl, succ);
+        return;
+    }
+
+    /* follow the successors from node 0 */
+    int v = 0;
+    for (int p = 0; p < t->nnodes; p++) {
+        t->order[p] = v;
+        t->pos[v] = p;
+        v = succ[v];
+    }
+    assert(v == 0 && "successor array is not a tour");
+}
+
+void tour_to_succ(tour t, int* succ) {
+    if (t->tl != NULL) {
+        twolevel_to_succ(t->tl, succ);
+        return;
+    }
+
+    int n = t->nnodes;
+
+    for (int p = 0; p < n - 1; p++) succ[t->order[p]] = t->order[p + 1];
+    succ[t->order[n - 1]] = t->order[0];
+}
+
+void tour_free(tour t) {
+    if (t == NULL) return;
+
+    free(t->order);
+    free(t->pos);
+    twolevel_free(t->tl);
+
+    free(t);
+}
+
+/* queries */
+int tour_next(tour t, int v) {
+    if (t->tl != NULL) return twolevel_next(t->tl, v);
+
+    int p = t->pos[v] + 1;
+    return t->order[p == t->nnodes ? 0 : p];
+}
+int tour_prev(tour t, int v) {
+    if (t->tl != NULL) return twolevel_prev(t->tl, v);
+
+    int p = t->pos[v] - 1;
+    return t->order[p < 0 ? t->nnodes - 1 : p];
+}
+int tour_between(tour t, int a, int b, int c) {
+    /* b lies on the forward path from a to c, ends included */
+    if (t->tl != NULL) return twolevel_between(t->tl, a, b, c);
+
+    int pa = t->pos[a], pb = t->pos[b], pc = t->pos[c];
+
+    if (pa <= pc) return pa <= pb && pb <= pc;
+    return pb >= pa || pb <= pc;
+}
+
+/* moves */
+void tour_reverse(tour t, int a, int b) {
+    if (t->tl != NULL) {
+        twolevel_reverse_path(t->tl, a, b);
+        return;
+    }
+
+    int n = t->nnodes;
+    int i = t->pos[a], j = t->pos[b];
+
+    /* nodes on the forward path a ~-> b */
+    int len = j - i + 1;
+    if (len <= 0) len += n;
+
+    /* reversing the complement gives the same cycle: pick the shorter */
+    if (2 * len > n) {
+        int ni = j + 1, nj = i - 1;
+        i = ni == n ? 0 : ni;
+        j = nj < 0 ? n - 1 : nj;
+        len = n - len;
+    }
+
+    /* swap from both ends towards the middle, wrapping around */
+    for (int k = 0; k < len / 2; k++) {
+        int u = t->order[i], v = t->order[j];
+        t->order[i] = v;
+        t->pos[v] = i;
+        t->order[j] = u;
+        t->pos[u] = j;
+
+        if (++i == n) i = 0;
+        if (--j < 0) j = n - 1;
+    }
+}
+
+void tour_make2opt(tour t, int t1, int t2, int t3, int t4) {
+    /* (t1, t2), (t3, t4) becomes (t1, t3), (t2, t4): both pairs must be
+     * consecutive in the same direction */
+    if (tour_next(t, t1) == t2) {
+        assert(tour_next(t, t3) == t4);
+        tour_reverse(t, t2, t3);
+    } else {
+        assert(tour_prev(t, t1) == t2 && tour_prev(t, t3) == t4);
+        tour_reverse(t, t3, t2);
+    }
+}
+
+void tour_make3opt(tour t, int a, int b, int c, int reconnection) {
+    /* a, b, c in forward order, S1 = a'..b and S2 = b'..c where x' is the
+     * successor of x: the pure 3opt reconnections as sequences of 2opt moves
+     *   0: a S1' S2' c'    1: a S2 S1 c'    2: a S2 S1' c'    3: a S2' S1 c'
+     */
+    int an = tour_next(t, a), bn = tour_next(t, b), cn = tour_next(t, c);
+    assert(tour_between(t, an, b, c) && tour_between(t, bn, c, a));
+
+    switch (reconnection) {
+        case 0:
+            tour_make2opt(t, a, an, b, bn);
+            tour_make2opt(t, an, bn, c, cn);
+            break;
+        case 1:
+            tour_make2opt(t, a, an, c, cn);
+            tour_make2opt(t, a, c, bn, b);
+            tour_make2opt(t, c, b, an, cn);
+            break;
+        case 2:
+            tour_make2opt(t, a, an, c, cn);
+            tour_make2opt(t, a, c, bn, b);
+            break;
+        case 3:
+            tour_make2opt(t, a, an, c, cn);
+            tour_make2opt(t, bn, b, an, cn);
+            break;
+        default:
+            assert(0 && "unknown 3opt reconnection");
+    }
+}
@@ -6,6 +6,8 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "../include/candidates.h"
+#include "../include/distcache.h"
 #include "../include/globals.h"
 #include "../include/string.h"
 #include "../include/utils.h"
@@ -19,6 +21,11 @@ cplex_params create_params() {
     params->num_threads = -1;
     params->timelimit = CPX_INFBOUND;
     params->available_memory = 4096;
+    params->distance_cache = NO_CACHE;
+    params->candidate_type = KNN_CANDIDATES;
+    params->refinement_type = TWOOPT_REFINEMENT;
+    params->crossover_type = ORDER_CROSSOVER;
+    params->neighbor_lists = 0;
 
     return params;
 }
@@ -30,6 +37,11 @@ void add_params(instance inst, cplex_params params) {
     inst->params->num_threads = params->num_threads;
     inst->params->timelimit = params->timelimit;
     inst->params->available_memory = params->available_memory;
+    inst->params->distance_cache = params->distance_cache;
+    inst->params->candidate_type = params->candidate_type;
+    inst->params->refinement_type = params->refinement_type;
+    inst->params->crossover_type = params->crossover_type;
+    inst->params->neighbor_lists = params->neighbor_lists;
 
     /* memcpy(inst->params, params, sizeof(struct cplex_params_t)); */
 }
@@ -152,6 +164,15 @@ void free_instance(instance inst) {
     free(inst->params);
 
     free(inst->nodes);
+    free(inst->xs);
+    free(inst->ys);
+    free(inst->cosx);
+    free(inst->sinx);
+    free(inst->cosy);
+    free(inst->siny);
+    distcache_free(inst->dcache);
+    rowcache_free(inst->rcache);
+    candidates_free(inst->cands);
 
     for (int i = 0; i < inst->nsols; i++) free_solution(inst->sols[i]);
     free(inst->sols);
@@ -263,6 +284,19 @@ void print_cplex_params(cplex_params params) {
     printf("- number of threads: %d\n", params->num_threads);
     printf("- time limit: %lf\n", params->timelimit);
     printf("- available memory: %d MB\n", params->available_memory);
+    char* distcache_str = distcache_type_tostring(params->distance_cache);
+    printf("- distance cache: %s\n", distcache_str);
+    free(distcache_str);
+    char* candidate_str = candidate_type_tostring(params->candidate_type);
+    printf("- candidates: %s\n", candidate_str);
+    free(candidate_str);
+    char* refinement_str = refinement_type_tostring(params->refinement_type);
+    printf("- refinement: %s\n", refinement_str);
+    free(refinement_str);
+    char* crossover_str = crossover_type_tostring(params->crossover_type);
+    printf("- crossover: %s\n", crossover_str);
+    free(crossover_str);
+    printf("- neighbor lists: %d\n", params->neighbor_lists);
     printf("- costs type: ");
 }
 void print_solution(solution sol, int print_data) {
@@ -293,6 +327,11 @@ void print_solution(solution sol, int print_data) {
         }
     }
     printf("- distance time: %lf ms\n", sol->distance_time);
+    if (sol->inst != NULL && sol->inst->rcache != NULL) {
+        rowcache rc = sol->inst->rcache;
+        printf("- row cache: %d rows, %ld hits, %ld misses\n", rc->nrows,
+               rc->hits, rc->misses);
+    }
     printf("- build time: %lf ms\n", sol->build_time);
     printf("- solve time: %lf s\n", sol->solve_time / 1000.0);
     if (print_data) {
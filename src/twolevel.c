@@ -0,0 +1,446 @@
+#include "../include/twolevel.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "../include/globals.h"
+#include "../include/utils.h"
+
+/* reading a segment in the tour direction */
+int tl_first(twolevel tl, int s);
+int tl_last(twolevel tl, int s);
+int tl_inext(twolevel tl, int v);
+int tl_iprev(twolevel tl, int v);
+int tl_offset(twolevel tl, int v);
+int tl_cmp(twolevel tl, int u, int v);
+
+/* segments surgery */
+void tl_build(twolevel tl);
+void tl_append(twolevel tl, int s, int u);
+void tl_prepend(twolevel tl, int s, int u);
+void tl_split(twolevel tl, int v, int protect);
+void tl_cut(twolevel tl, int s);
+void tl_reverse_inside(twolevel tl, int a, int b);
+void tl_reverse_run(twolevel tl, int s1, int k);
+
+/* reading a segment in the tour direction */
+int tl_first(twolevel tl, int s) {
+    return tl->rev[s] ? tl->last[s] : tl->first[s];
+}
+int tl_last(twolevel tl, int s) {
+    return tl->rev[s] ? tl->first[s] : tl->last[s];
+}
+int tl_inext(twolevel tl, int v) {
+    return tl->rev[tl->seg[v]] ? tl->prv[v] : tl->nxt[v];
+}
+int tl_iprev(twolevel tl, int v) {
+    return tl->rev[tl->seg[v]] ? tl->nxt[v] : tl->prv[v];
+}
+int tl_offset(twolevel tl, int v) {
+    /* nodes before v in its segment */
+    int s = tl->seg[v];
+    return tl->rev[s] ? tl->id[tl->last[s]] - tl->id[v]
+                      : tl->id[v] - tl->id[tl->first[s]];
+}
+int tl_cmp(twolevel tl, int u, int v) {
+    /* order of u and v in the tour read from the segment of rank 0 */
+    int su = tl->seg[u], sv = tl->seg[v];
+
+    if (su != sv) return tl->rank[su] < tl->rank[sv] ? -1 : 1;
+    if (u == v) return 0;
+    return tl_offset(tl, u) < tl_offset(tl, v) ? -1 : 1;
+}
+
+/* segments surgery */
+void tl_build(twolevel tl) {
+    /* cut tl->order in segments of groupsize nodes */
+    int n = tl->nnodes;
+
+    tl->groupsize = maxi(1, (int)sqrt(n));
+    tl->nsegs = (n + tl->groupsize - 1) / tl->groupsize;
+    tl->maxsegs = 2 * tl->nsegs;
+    tl->unbalanced = 0;
+
+    for (int s = 0; s < tl->nsegs; s++) {
+        tl->size[s] = 0;
+        tl->rev[s] = 0;
+        tl->rank[s] = s;
+        tl->snext[s] = (s + 1) % tl->nsegs;
+        tl->sprev[s] = (s - 1 + tl->nsegs) % tl->nsegs;
+    }
+
+    for (int p = 0; p < n; p++) {
+        int v = tl->order[p];
+        int s = p / tl->groupsize;
+
+        tl->seg[v] = s;
+        tl->id[v] = tl->size[s];
+        tl->prv[v] = tl->size[s] == 0 ? -1 : tl->order[p - 1];
+        tl->nxt[v] = -1;
+        if (tl->size[s] == 0) {
+            tl->first[s] = v;
+        } else {
+            tl->nxt[tl->order[p - 1]] = v;
+        }
+        tl->last[s] = v;
+        tl->size[s]++;
+    }
+}
+void tl_append(twolevel tl, int s, int u) {
+    /* u becomes the last node of s in the tour direction */
+    if (!tl->rev[s]) {
+        int w = tl->last[s];
+        tl->nxt[w] = u;
+        tl->prv[u] = w;
+        tl->nxt[u] = -1;
+        tl->id[u] = tl->id[w] + 1;
+        tl->last[s] = u;
+    } else {
+        int w = tl->first[s];
+        tl->prv[w] = u;
+        tl->nxt[u] = w;
+        tl->prv[u] = -1;
+        tl->id[u] = tl->id[w] - 1;
+        tl->first[s] = u;
+    }
+    tl->seg[u] = s;
+    tl->size[s]++;
+
+    if (abs(tl->id[u]) > INT_MAX / 2) tl->unbalanced = 1;
+}
+void tl_prepend(twolevel tl, int s, int u) {
+    /* u becomes the first node of s in the tour direction */
+    if (!tl->rev[s]) {
+        int w = tl->first[s];
+        tl->prv[w] = u;
+        tl->nxt[u] = w;
+        tl->prv[u] = -1;
+        tl->id[u] = tl->id[w] - 1;
+        tl->first[s] = u;
+    } else {
+        int w = tl->last[s];
+        tl->nxt[w] = u;
+        tl->prv[u] = w;
+        tl->nxt[u] = -1;
+        tl->id[u] = tl->id[w] + 1;
+        tl->last[s] = u;
+    }
+    tl->seg[u] = s;
+    tl->size[s]++;
+
+    if (abs(tl->id[u]) > INT_MAX / 2) tl->unbalanced = 1;
+}
+void tl_split(twolevel tl, int v, int protect) {
+    /* make v the first node of its segment, moving the shorter part to the
+     * adjacent segment: the one after must not be protect, whose first
+     * node has to stay first */
+    int s = tl->seg[v];
+    if (tl_first(tl, s) == v) return;
+
+    int nbefore = tl_offset(tl, v);
+    int nafter = tl->size[s] - nbefore;
+    int pv = tl_iprev(tl, v);
+    int t;
+
+    if (nbefore <= nafter || tl->snext[s] == protect) {
+        /* head ~-> pv goes at the end of the previous segment */
+        t = tl->sprev[s];
+        int u = tl_first(tl, s);
+        for (int k = 0; k < nbefore; k++) {
+            int nu = tl_inext(tl, u);
+            tl_append(tl, t, u);
+            u = nu;
+        }
+
+        if (!tl->rev[s]) {
+            tl->first[s] = v;
+            tl->prv[v] = -1;
+        } else {
+            tl->last[s] = v;
+            tl->nxt[v] = -1;
+        }
+        tl->size[s] -= nbefore;
+    } else {
+        /* v ~-> tail goes at the beginning of the next segment */
+        t = tl->snext[s];
+        int u = tl_last(tl, s);
+        for (int k = 0; k < nafter; k++) {
+            int pu = tl_iprev(tl, u);
+            tl_prepend(tl, t, u);
+            u = pu;
+        }
+
+        if (!tl->rev[s]) {
+            tl->last[s] = pv;
+            tl->nxt[pv] = -1;
+        } else {
+            tl->first[s] = pv;
+            tl->prv[pv] = -1;
+        }
+        tl->size[s] -= nafter;
+    }
+
+    /* the receiving segment grew too much: halve it */
+    if (tl->size[t] > TWOLEVEL_MAX_GROUP_FACTOR * tl->groupsize) tl_cut(tl, t);
+}
+void tl_cut(twolevel tl, int s) {
+    /* second half of s, in the tour direction, becomes a new segment right
+     * after it, with the same orientation */
+    int ns = tl->nsegs++;
+    int half = tl->size[s] / 2;
+
+    int w = tl_first(tl, s);
+    for (int k = 0; k < half; k++) w = tl_inext(tl, w);
+
+    tl->rev[ns] = tl->rev[s];
+    tl->size[ns] = tl->size[s] - half;
+    tl->size[s] = half;
+    if (!tl->rev[s]) {
+        tl->first[ns] = w;
+        tl->last[ns] = tl->last[s];
+        tl->last[s] = tl->prv[w];
+        tl->nxt[tl->prv[w]] = -1;
+        tl->prv[w] = -1;
+    } else {
+        tl->first[ns] = tl->first[s];
+        tl->last[ns] = w;
+        tl->first[s] = tl->nxt[w];
+        tl->prv[tl->nxt[w]] = -1;
+        tl->nxt[w] = -1;
+    }
+    for (int u = tl->first[ns]; u != -1; u = tl->nxt[u]) tl->seg[u] = ns;
+
+    /* link it in the ring and shift the ranks after it */
+    tl->snext[ns] = tl->snext[s];
+    tl->sprev[ns] = s;
+    tl->sprev[tl->snext[s]] = ns;
+    tl->snext[s] = ns;
+
+    int r = tl->rank[s];
+    for (int x = ns; x != s; x = tl->snext[x]) {
+        r = (r + 1) % tl->nsegs;
+        tl->rank[x] = r;
+    }
+
+    /* too many segments now: rebuild on the next occasion */
+    if (tl->nsegs >= tl->maxsegs) tl->unbalanced = 1;
+}
+void tl_reverse_inside(twolevel tl, int a, int b) {
+    /* a ~-> b lies in a single segment */
+    int s = tl->seg[a];
+
+    if (a == tl_first(tl, s) && b == tl_last(tl, s)) {
+        tl->rev[s] ^= 1;
+        return;
+    }
+
+    /* relink the internal chain p ~-> q backwards */
+    int p = tl->rev[s] ? b : a;
+    int q = tl->rev[s] ? a : b;
+    int pp = tl->prv[p], qq = tl->nxt[q];
+    int lo = tl->id[p], hi = tl->id[q];
+
+    int u = p;
+    while (1) {
+        int nu = tl->nxt[u];
+        swap(&tl->nxt[u], &tl->prv[u]);
+        tl->id[u] = lo + hi - tl->id[u];
+        if (u == q) break;
+        u = nu;
+    }
+
+    tl->prv[q] = pp;
+    tl->nxt[p] = qq;
+    if (pp != -1) {
+        tl->nxt[pp] = q;
+    } else {
+        tl->first[s] = q;
+    }
+    if (qq != -1) {
+        tl->prv[qq] = p;
+    } else {
+        tl->last[s] = p;
+    }
+}
+void tl_reverse_run(twolevel tl, int s1, int k) {
+    /* reverse the order of the k segments from s1 on and flip them */
+    int m = tl->nsegs;
+    int* run = tl->run;
+
+    run[0] = s1;
+    for (int i = 1; i < k; i++) run[i] = tl->snext[run[i - 1]];
+
+    int before = tl->sprev[run[0]];
+    int after = tl->snext[run[k - 1]];
+    int r0 = tl->rank[s1];
+
+    int prevseg = before;
+    for (int i = 0; i < k; i++) {
+        int s = run[k - 1 - i];
+        tl->rank[s] = (r0 + i) % m;
+        tl->rev[s] ^= 1;
+
+        tl->sprev[s] = prevseg;
+        tl->snext[prevseg] = s;
+        prevseg = s;
+    }
+    tl->snext[prevseg] = after;
+    tl->sprev[after] = prevseg;
+}
+
+/* manipulators */
+twolevel twolevel_create(int* succ, int nnodes) {
+    assert(nnodes >= 3);
+
+    twolevel tl = (twolevel)calloc(1, sizeof(struct twolevel_t));
+    tl->nnodes = nnodes;
+
+    tl->seg = (int*)malloc(nnodes * sizeof(int));
+    tl->id = (int*)malloc(nnodes * sizeof(int));
+    tl->nxt = (int*)malloc(nnodes * sizeof(int));
+    tl->prv = (int*)malloc(nnodes * sizeof(int));
+
+    /* never more segments than nodes */
+    tl->first = (int*)malloc(nnodes * sizeof(int));
+    tl->last = (int*)malloc(nnodes * sizeof(int));
+    tl->size = (int*)malloc(nnodes * sizeof(int));
+    tl->rev = (char*)malloc(nnodes * sizeof(char));
+    tl->rank = (int*)malloc(nnodes * sizeof(int));
+    tl->snext = (int*)malloc(nnodes * sizeof(int));
+    tl->sprev = (int*)malloc(nnodes * sizeof(int));
+
+    tl->run = (int*)malloc(nnodes * sizeof(int));
+    tl->order = (int*)malloc(nnodes * sizeof(int));
+
+    twolevel_load_succ(tl, succ);
+
+    return tl;
+}
+
+void twolevel_load_succ(twolevel tl, int* succ) {
+    assert(succ != NULL);
+
+    int v = 0;
+    for (int p = 0; p < tl->nnodes; p++) {
+        tl->order[p] = v;
+        v = succ[v];
+    }
+    assert(v == 0 && "successor array is not a tour");
+
+    tl_build(tl);
+}
+
+void twolevel_to_succ(twolevel tl, int* succ) {
+    for (int v = 0; v < tl->nnodes; v++) succ[v] = twolevel_next(tl, v);
+}
+
+void twolevel_free(twolevel tl) {
+    if (tl == NULL) return;
+
+    free(tl->seg);
+    free(tl->id);
+    free(tl->nxt);
+    free(tl->prv);
+    free(tl->first);
+    free(tl->last);
+    free(tl->size);
+    free(tl->rev);
+    free(tl->rank);
+    free(tl->snext);
+    free(tl->sprev);
+    free(tl->run);
+    free(tl->order);
+
+    free(tl);
+}
+
+/* queries */
+int twolevel_next(twolevel tl, int v) {
+    int u = tl_inext(tl, v);
+    return u != -1 ? u : tl_first(tl, tl->snext[tl->seg[v]]);
+}
+int twolevel_prev(twolevel tl, int v) {
+    int u = tl_iprev(tl, v);
+    return u != -1 ? u : tl_last(tl, tl->sprev[tl->seg[v]]);
+}
+int twolevel_between(twolevel tl, int a, int b, int c) {
+    /* b lies on the forward path from a to c, ends included */
+    if (tl_cmp(tl, a, c) <= 0) {
+        return tl_cmp(tl, a, b) <= 0 && tl_cmp(tl, b, c) <= 0;
+    }
+    return tl_cmp(tl, a, b) <= 0 || tl_cmp(tl, b, c) <= 0;
+}
+int twolevel_reachable(twolevel tl, int i, int j) {
+    /* forward steps from i to j */
+    int si = tl->seg[i], sj = tl->seg[j];
+
+    if (si == sj && tl_offset(tl, i) <= tl_offset(tl, j)) {
+        return tl_offset(tl, j) - tl_offset(tl, i);
+    }
+
+    int steps = tl->size[si] - tl_offset(tl, i);
+    for (int s = tl->snext[si]; s != sj; s = tl->snext[s]) {
+        steps += tl->size[s];
+    }
+
+    return steps + tl_offset(tl, j);
+}
+
+/* moves */
+void twolevel_reverse_path(twolevel tl, int start, int end) {
+    if (start == end) return;
+
+    /* short path inside a segment */
+    if (tl->seg[start] == tl->seg[end] && tl_cmp(tl, start, end) < 0) {
+        tl_reverse_inside(tl, start, end);
+        return;
+    }
+
+    int after = twolevel_next(tl, end);
+    if (after == start) return; /* whole tour: same cycle */
+
+    /* align start and after to the segments boundaries */
+    tl_split(tl, start, -1);
+    if (tl->seg[start] == tl->seg[end]) {
+        tl_reverse_inside(tl, start, end);
+    } else {
+        tl_split(tl, after, tl->seg[start]);
+        assert(tl_first(tl, tl->seg[start]) == start);
+        assert(tl_last(tl, tl->seg[end]) == end);
+
+        /* reverse the shorter run of segments: same cycle */
+        int m = tl->nsegs;
+        int sa = tl->seg[start], sb = tl->seg[end];
+        int k = (tl->rank[sb] - tl->rank[sa] + m) % m + 1;
+
+        if (2 * k <= m) {
+            tl_reverse_run(tl, sa, k);
+        } else {
+            tl_reverse_run(tl, tl->seg[after], m - k);
+        }
+    }
+
+    /* too many segments or ids about to overflow: cut them again */
+    if (tl->unbalanced) {
+        int v = start;
+        for (int p = 0; p < tl->nnodes; p++) {
+            tl->order[p] = v;
+            v = twolevel_next(tl, v);
+        }
+        tl_build(tl);
+    }
+}
+
+void twolevel_make2opt(twolevel tl, int t1, int t2, int t3, int t4) {
+    /* (t1, t2), (t3, t4) becomes (t1, t3), (t2, t4): both pairs must be
+     * consecutive in the same direction */
+    if (twolevel_next(tl, t1) == t2) {
+        assert(twolevel_next(tl, t3) == t4);
+        twolevel_reverse_path(tl, t2, t3);
+    } else {
+        assert(twolevel_prev(tl, t1) == t2 && twolevel_prev(tl, t3) == t4);
+        twolevel_reverse_path(tl, t3, t2);
+    }
+}
@@ -10,11 +10,51 @@
 #include <sys/time.h>
 #include <time.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define DIST_SIMD
+#endif
+
+/* the row cache reorders its lru list on every hit: threads go around it */
+#ifdef _OPENMP
+#include <omp.h>
+#define IN_PARALLEL() omp_in_parallel()
+#else
+#define IN_PARALLEL() 0
+#endif
+
+#include "../include/distcache.h"
 #include "../include/globals.h"
 #include "../include/tsp.h"
 
 double l2dist(size_t i, size_t j, instance inst);
 double geodist(size_t i, size_t j, instance inst);
+double geoacos(double q);
+
+/* batch distance kernels: out[k] = dist(i, js ? js[k] : first + k) */
+void dist_batch(instance inst, int i, int first, const int* js, int count,
+                double* out);
+void dist_batch_scalar(instance inst, int i, int first, const int* js,
+                       int count, double* out);
+#ifdef DIST_SIMD
+void dist_batch_sse2(instance inst, int i, int first, const int* js, int count,
+                     double* out);
+void dist_batch_avx2(instance inst, int i, int first, const int* js, int count,
+                     double* out);
+#endif
+
+/* 2opt deltas kernels over j in [first, first + count) for a fixed i */
+double twoopt_row_best_scalar(instance inst, int* succ, const double* dsucc,
+                              const double* penalty, int i, int first,
+                              int count, int* bestj);
+#ifdef DIST_SIMD
+double twoopt_row_best_avx2(instance inst, int* succ, const double* dsucc,
+                            const double* penalty, int i, int first, int count,
+                            int* bestj);
+double twoopt_row_best_avx512(instance inst, int* succ, const double* dsucc,
+                              const double* penalty, int i, int first,
+                              int count, int* bestj);
+#endif
 
 /* cplex position helpers */
 int xpos(int i, int j, int nnodes) {
@@ -103,19 +143,42 @@ double l2dist(size_t i, size_t j, instance inst) {
 }
 double geodist(size_t i, size_t j, instance inst) {
     // TODO(lugot): NOT CHECKED FOR FLOATING POINT SAFETY
-    double RRR = 637.388;
-    double q1 = cos(inst->nodes[i].x - inst->nodes[j].x);
-    double q2 = cos(inst->nodes[i].y - inst->nodes[j].y);
-    double q3 = cos(inst->nodes[i].y + inst->nodes[j].y);
+    double q1, q2, q3;
+    if (inst->cosx != NULL) {
+        /* same expansion of the batch kernels, so they agree bit by bit */
+        q1 = inst->cosx[i] * inst->cosx[j] + inst->sinx[i] * inst->sinx[j];
+        q2 = inst->cosy[i] * inst->cosy[j] + inst->siny[i] * inst->siny[j];
+        q3 = inst->cosy[i] * inst->cosy[j] - inst->siny[i] * inst->siny[j];
+    } else {
+        q1 = cos(inst->nodes[i].x - inst->nodes[j].x);
+        q2 = cos(inst->nodes[i].y - inst->nodes[j].y);
+        q3 = cos(inst->nodes[i].y + inst->nodes[j].y);
+    }
 
-    double distance =
-        RRR * acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0;
+    double distance = geoacos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3));
 
     return distance;
     /* if (inst->params->cost == REAL) return distance; */
     /* return 0.0 + (int)distance; */
 }
+double geoacos(double q) {
+    double RRR = 637.388;
+
+    /* the cosines expansion can exceed 1 by an ulp: keep acos defined */
+    return RRR * acos(max(-1.0, min(1.0, q))) + 1.0;
+}
 double dist(int i, int j, instance inst) {
+    /* cached distances first, if any */
+    if (inst->dcache != NULL && i != j) {
+        return distcache_get(inst->dcache, i, j);
+    }
+    if (inst->rcache != NULL && i != j && !IN_PARALLEL()) {
+        return rowcache_get(inst->rcache, inst, i, j);
+    }
+
+    return dist_compute(i, j, inst);
+}
+double dist_compute(int i, int j, instance inst) {
     switch (inst->weight_type) {
         case ATT:
         case EUC_2D:
@@ -133,6 +196,409 @@ double dist(int i, int j, instance inst) {
 
     return 0.0; /* warning suppressor */
 }
+
+/* batch distances */
+void build_nodes_soa(instance inst) {
+    assert(inst != NULL);
+    if (inst->xs != NULL || inst->nodes == NULL) return;
+
+    int nnodes = inst->nnodes;
+
+    inst->xs = (double*)malloc(nnodes * sizeof(double));
+    inst->ys = (double*)malloc(nnodes * sizeof(double));
+    for (int i = 0; i < nnodes; i++) {
+        inst->xs[i] = inst->nodes[i].x;
+        inst->ys[i] = inst->nodes[i].y;
+    }
+
+    if (inst->weight_type == GEO) {
+        inst->cosx = (double*)malloc(nnodes * sizeof(double));
+        inst->sinx = (double*)malloc(nnodes * sizeof(double));
+        inst->cosy = (double*)malloc(nnodes * sizeof(double));
+        inst->siny = (double*)malloc(nnodes * sizeof(double));
+        for (int i = 0; i < nnodes; i++) {
+            inst->cosx[i] = cos(inst->nodes[i].x);
+            inst->sinx[i] = sin(inst->nodes[i].x);
+            inst->cosy[i] = cos(inst->nodes[i].y);
+            inst->siny[i] = sin(inst->nodes[i].y);
+        }
+    }
+}
+void dist_row(instance inst, int i, int first, int count, double* out) {
+    if (inst->dcache != NULL) {
+        for (int k = 0; k < count; k++) out[k] = dist(i, first + k, inst);
+        return;
+    }
+    if (inst->rcache != NULL && !IN_PARALLEL()) {
+        double* row = rowcache_row(inst->rcache, inst, i);
+        memcpy(out, row + first, count * sizeof(double));
+        return;
+    }
+
+    dist_batch(inst, i, first, NULL, count, out);
+}
+void dist_many(instance inst, int i, const int* js, int count, double* out) {
+    if (inst->dcache != NULL) {
+        for (int k = 0; k < count; k++) out[k] = dist(i, js[k], inst);
+        return;
+    }
+    /* a few distances never pay for a whole row: only a resident one */
+    double* row = NULL;
+    if (inst->rcache != NULL && !IN_PARALLEL()) {
+        row = rowcache_peek(inst->rcache, i);
+    }
+    if (row != NULL) {
+        for (int k = 0; k < count; k++) out[k] = row[js[k]];
+        return;
+    }
+
+    dist_batch(inst, i, 0, js, count, out);
+}
+void dist_row_compute(instance inst, int i, int first, int count,
+                      double* out) {
+    dist_batch(inst, i, first, NULL, count, out);
+}
+void dist_batch(instance inst, int i, int first, const int* js, int count,
+                double* out) {
+    /* kernels work on the structure of arrays copy only */
+    int handled = inst->weight_type == ATT || inst->weight_type == EUC_2D ||
+                  inst->weight_type == GEO;
+    if (inst->xs == NULL || !handled) {
+        for (int k = 0; k < count; k++) {
+            out[k] = dist_compute(i, js != NULL ? js[k] : first + k, inst);
+        }
+        return;
+    }
+
+#ifdef DIST_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        dist_batch_avx2(inst, i, first, js, count, out);
+    } else {
+        dist_batch_sse2(inst, i, first, js, count, out);
+    }
+#else
+    dist_batch_scalar(inst, i, first, js, count, out);
+#endif
+}
+void dist_batch_scalar(instance inst, int i, int first, const int* js,
+                       int count, double* out) {
+    for (int k = 0; k < count; k++) {
+        out[k] = dist_compute(i, js != NULL ? js[k] : first + k, inst);
+    }
+}
+#ifdef DIST_SIMD
+void dist_batch_sse2(instance inst, int i, int first, const int* js, int count,
+                     double* out) {
+    int k = 0;
+
+    if (inst->weight_type == GEO) {
+        /* vector expansion of the cosines, acos lane by lane */
+        __m128d one = _mm_set1_pd(1.0), minusone = _mm_set1_pd(-1.0);
+        __m128d half = _mm_set1_pd(0.5);
+        __m128d cxi = _mm_set1_pd(inst->cosx[i]);
+        __m128d sxi = _mm_set1_pd(inst->sinx[i]);
+        __m128d cyi = _mm_set1_pd(inst->cosy[i]);
+        __m128d syi = _mm_set1_pd(inst->siny[i]);
+        for (; k + 2 <= count; k += 2) {
+            int j0 = js != NULL ? js[k] : first + k;
+            int j1 = js != NULL ? js[k + 1] : first + k + 1;
+            __m128d cxj = _mm_set_pd(inst->cosx[j1], inst->cosx[j0]);
+            __m128d sxj = _mm_set_pd(inst->sinx[j1], inst->sinx[j0]);
+            __m128d cyj = _mm_set_pd(inst->cosy[j1], inst->cosy[j0]);
+            __m128d syj = _mm_set_pd(inst->siny[j1], inst->siny[j0]);
+
+            __m128d q1 = _mm_add_pd(_mm_mul_pd(cxi, cxj), _mm_mul_pd(sxi, sxj));
+            __m128d q2 = _mm_add_pd(_mm_mul_pd(cyi, cyj), _mm_mul_pd(syi, syj));
+            __m128d q3 = _mm_sub_pd(_mm_mul_pd(cyi, cyj), _mm_mul_pd(syi, syj));
+            __m128d q = _mm_mul_pd(
+                half, _mm_sub_pd(_mm_mul_pd(_mm_add_pd(one, q1), q2),
+                                 _mm_mul_pd(_mm_sub_pd(one, q1), q3)));
+            q = _mm_max_pd(minusone, _mm_min_pd(one, q));
+
+            _mm_storeu_pd(out + k, q);
+            out[k] = geoacos(out[k]);
+            out[k + 1] = geoacos(out[k + 1]);
+        }
+    } else {
+        __m128d xi = _mm_set1_pd(inst->xs[i]);
+        __m128d yi = _mm_set1_pd(inst->ys[i]);
+        for (; k + 2 <= count; k += 2) {
+            __m128d xj, yj;
+            if (js != NULL) {
+                xj = _mm_set_pd(inst->xs[js[k + 1]], inst->xs[js[k]]);
+                yj = _mm_set_pd(inst->ys[js[k + 1]], inst->ys[js[k]]);
+            } else {
+                xj = _mm_loadu_pd(inst->xs + first + k);
+                yj = _mm_loadu_pd(inst->ys + first + k);
+            }
+
+            __m128d dx = _mm_sub_pd(xi, xj);
+            __m128d dy = _mm_sub_pd(yi, yj);
+            __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+            _mm_storeu_pd(out + k, _mm_sqrt_pd(d2));
+        }
+    }
+
+    /* leftovers */
+    dist_batch_scalar(inst, i, first + k, js != NULL ? js + k : NULL,
+                      count - k, out + k);
+}
+__attribute__((target("avx2"))) void dist_batch_avx2(instance inst, int i,
+                                                     int first, const int* js,
+                                                     int count, double* out) {
+    int k = 0;
+
+    if (inst->weight_type == GEO) {
+        /* vector expansion of the cosines, acos lane by lane */
+        __m256d one = _mm256_set1_pd(1.0), minusone = _mm256_set1_pd(-1.0);
+        __m256d half = _mm256_set1_pd(0.5);
+        __m256d cxi = _mm256_set1_pd(inst->cosx[i]);
+        __m256d sxi = _mm256_set1_pd(inst->sinx[i]);
+        __m256d cyi = _mm256_set1_pd(inst->cosy[i]);
+        __m256d syi = _mm256_set1_pd(inst->siny[i]);
+        for (; k + 4 <= count; k += 4) {
+            __m256d cxj, sxj, cyj, syj;
+            if (js != NULL) {
+                __m128i idx = _mm_loadu_si128((const __m128i*)(js + k));
+                cxj = _mm256_i32gather_pd(inst->cosx, idx, 8);
+                sxj = _mm256_i32gather_pd(inst->sinx, idx, 8);
+                cyj = _mm256_i32gather_pd(inst->cosy, idx, 8);
+                syj = _mm256_i32gather_pd(inst->siny, idx, 8);
+            } else {
+                cxj = _mm256_loadu_pd(inst->cosx + first + k);
+                sxj = _mm256_loadu_pd(inst->sinx + first + k);
+                cyj = _mm256_loadu_pd(inst->cosy + first + k);
+                syj = _mm256_loadu_pd(inst->siny + first + k);
+            }
+
+            __m256d q1 = _mm256_add_pd(_mm256_mul_pd(cxi, cxj),
+                                       _mm256_mul_pd(sxi, sxj));
+            __m256d q2 = _mm256_add_pd(_mm256_mul_pd(cyi, cyj),
+                                       _mm256_mul_pd(syi, syj));
+            __m256d q3 = _mm256_sub_pd(_mm256_mul_pd(cyi, cyj),
+                                       _mm256_mul_pd(syi, syj));
+            __m256d q = _mm256_mul_pd(
+                half,
+                _mm256_sub_pd(_mm256_mul_pd(_mm256_add_pd(one, q1), q2),
+                              _mm256_mul_pd(_mm256_sub_pd(one, q1), q3)));
+            q = _mm256_max_pd(minusone, _mm256_min_pd(one, q));
+
+            _mm256_storeu_pd(out + k, q);
+            for (int l = k; l < k + 4; l++) out[l] = geoacos(out[l]);
+        }
+    } else {
+        __m256d xi = _mm256_set1_pd(inst->xs[i]);
+        __m256d yi = _mm256_set1_pd(inst->ys[i]);
+        for (; k + 4 <= count; k += 4) {
+            __m256d xj, yj;
+            if (js != NULL) {
+                __m128i idx = _mm_loadu_si128((const __m128i*)(js + k));
+                xj = _mm256_i32gather_pd(inst->xs, idx, 8);
+                yj = _mm256_i32gather_pd(inst->ys, idx, 8);
+            } else {
+                xj = _mm256_loadu_pd(inst->xs + first + k);
+                yj = _mm256_loadu_pd(inst->ys + first + k);
+            }
+
+            __m256d dx = _mm256_sub_pd(xi, xj);
+            __m256d dy = _mm256_sub_pd(yi, yj);
+            __m256d d2 =
+                _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+            _mm256_storeu_pd(out + k, _mm256_sqrt_pd(d2));
+        }
+    }
+
+    /* leftovers */
+    dist_batch_scalar(inst, i, first + k, js != NULL ? js + k : NULL,
+                      count - k, out + k);
+}
+#endif
+
+/* batch 2opt deltas */
+int twoopt_row_fast(instance inst) {
+    return inst->dcache == NULL && inst->xs != NULL &&
+           (inst->weight_type == ATT || inst->weight_type == EUC_2D);
+}
+double twoopt_row_best(instance inst, int* succ, const double* dsucc,
+                       const double* penalty, int i, int first, int count,
+                       int* bestj) {
+    *bestj = -1;
+    if (!twoopt_row_fast(inst)) {
+        return twoopt_row_best_scalar(inst, succ, dsucc, penalty, i, first,
+                                      count, bestj);
+    }
+
+#ifdef DIST_SIMD
+    if (__builtin_cpu_supports("avx512f")) {
+        return twoopt_row_best_avx512(inst, succ, dsucc, penalty, i, first,
+                                      count, bestj);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return twoopt_row_best_avx2(inst, succ, dsucc, penalty, i, first,
+                                    count, bestj);
+    }
+#endif
+    return twoopt_row_best_scalar(inst, succ, dsucc, penalty, i, first, count,
+                                  bestj);
+}
+double twoopt_row_best_scalar(instance inst, int* succ, const double* dsucc,
+                              const double* penalty, int i, int first,
+                              int count, int* bestj) {
+    double best = INFINITY;
+
+    for (int j = first; j < first + count; j++) {
+        double delta = dist(i, j, inst) + dist(succ[i], succ[j], inst) -
+                       (dsucc[i] + dsucc[j]);
+        if (penalty != NULL) delta += penalty[j];
+
+        if (delta < best) {
+            best = delta;
+            *bestj = j;
+        }
+    }
+
+    return best;
+}
+#ifdef DIST_SIMD
+/* lanes keep their own best and its j, the reduction takes the smallest j
+ * among the lanes holding the minimum: same move of the scalar scan. No fma
+ * contraction, to get the same roundings of l2dist */
+__attribute__((target("avx2"), optimize("fp-contract=off"))) double
+twoopt_row_best_avx2(instance inst, int* succ, const double* dsucc,
+                     const double* penalty, int i, int first, int count,
+                     int* bestj) {
+    int si = succ[i];
+    __m256d xi = _mm256_set1_pd(inst->xs[i]);
+    __m256d yi = _mm256_set1_pd(inst->ys[i]);
+    __m256d xsi = _mm256_set1_pd(inst->xs[si]);
+    __m256d ysi = _mm256_set1_pd(inst->ys[si]);
+    __m256d dsi = _mm256_set1_pd(dsucc[i]);
+
+    __m256d vbest = _mm256_set1_pd(INFINITY);
+    __m256d vj = _mm256_set1_pd(-1.0);
+    __m256d jj = _mm256_set_pd(first + 3, first + 2, first + 1, first);
+    __m256d four = _mm256_set1_pd(4.0);
+
+    int k = 0;
+    for (; k + 4 <= count; k += 4) {
+        int j = first + k;
+
+        __m256d dx = _mm256_sub_pd(xi, _mm256_loadu_pd(inst->xs + j));
+        __m256d dy = _mm256_sub_pd(yi, _mm256_loadu_pd(inst->ys + j));
+        __m256d dij = _mm256_sqrt_pd(
+            _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+
+        /* coordinates of succ[j] gathered lane by lane */
+        __m128i idx = _mm_loadu_si128((const __m128i*)(succ + j));
+        dx = _mm256_sub_pd(xsi, _mm256_i32gather_pd(inst->xs, idx, 8));
+        dy = _mm256_sub_pd(ysi, _mm256_i32gather_pd(inst->ys, idx, 8));
+        __m256d dsisj = _mm256_sqrt_pd(
+            _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+
+        __m256d delta =
+            _mm256_sub_pd(_mm256_add_pd(dij, dsisj),
+                          _mm256_add_pd(dsi, _mm256_loadu_pd(dsucc + j)));
+        if (penalty != NULL) {
+            delta = _mm256_add_pd(delta, _mm256_loadu_pd(penalty + j));
+        }
+
+        __m256d lt = _mm256_cmp_pd(delta, vbest, _CMP_LT_OQ);
+        vbest = _mm256_blendv_pd(vbest, delta, lt);
+        vj = _mm256_blendv_pd(vj, jj, lt);
+        jj = _mm256_add_pd(jj, four);
+    }
+
+    double lbest[4], lj[4];
+    _mm256_storeu_pd(lbest, vbest);
+    _mm256_storeu_pd(lj, vj);
+
+    double best = INFINITY;
+    for (int l = 0; l < 4; l++) {
+        if (lbest[l] < best || (lbest[l] == best && lj[l] < *bestj)) {
+            best = lbest[l];
+            *bestj = (int)lj[l];
+        }
+    }
+
+    /* leftovers come after every lane */
+    int restj = -1;
+    double rest = twoopt_row_best_scalar(inst, succ, dsucc, penalty, i,
+                                         first + k, count - k, &restj);
+    if (rest < best) {
+        best = rest;
+        *bestj = restj;
+    }
+
+    return best;
+}
+__attribute__((target("avx512f"), optimize("fp-contract=off"))) double
+twoopt_row_best_avx512(instance inst, int* succ, const double* dsucc,
+                       const double* penalty, int i, int first, int count,
+                       int* bestj) {
+    int si = succ[i];
+    __m512d xi = _mm512_set1_pd(inst->xs[i]);
+    __m512d yi = _mm512_set1_pd(inst->ys[i]);
+    __m512d xsi = _mm512_set1_pd(inst->xs[si]);
+    __m512d ysi = _mm512_set1_pd(inst->ys[si]);
+    __m512d dsi = _mm512_set1_pd(dsucc[i]);
+
+    __m512d vbest = _mm512_set1_pd(INFINITY);
+    __m512d vj = _mm512_set1_pd(-1.0);
+    __m512d jj = _mm512_set_pd(first + 7, first + 6, first + 5, first + 4,
+                               first + 3, first + 2, first + 1, first);
+    __m512d eight = _mm512_set1_pd(8.0);
+
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        int j = first + k;
+
+        __m512d dx = _mm512_sub_pd(xi, _mm512_loadu_pd(inst->xs + j));
+        __m512d dy = _mm512_sub_pd(yi, _mm512_loadu_pd(inst->ys + j));
+        __m512d dij = _mm512_sqrt_pd(
+            _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)));
+
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(succ + j));
+        dx = _mm512_sub_pd(xsi, _mm512_i32gather_pd(idx, inst->xs, 8));
+        dy = _mm512_sub_pd(ysi, _mm512_i32gather_pd(idx, inst->ys, 8));
+        __m512d dsisj = _mm512_sqrt_pd(
+            _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)));
+
+        __m512d delta =
+            _mm512_sub_pd(_mm512_add_pd(dij, dsisj),
+                          _mm512_add_pd(dsi, _mm512_loadu_pd(dsucc + j)));
+        if (penalty != NULL) {
+            delta = _mm512_add_pd(delta, _mm512_loadu_pd(penalty + j));
+        }
+
+        __mmask8 lt = _mm512_cmp_pd_mask(delta, vbest, _CMP_LT_OQ);
+        vbest = _mm512_mask_blend_pd(lt, vbest, delta);
+        vj = _mm512_mask_blend_pd(lt, vj, jj);
+        jj = _mm512_add_pd(jj, eight);
+    }
+
+    double lbest[8], lj[8];
+    _mm512_storeu_pd(lbest, vbest);
+    _mm512_storeu_pd(lj, vj);
+
+    double best = INFINITY;
+    for (int l = 0; l < 8; l++) {
+        if (lbest[l] < best || (lbest[l] == best && lj[l] < *bestj)) {
+            best = lbest[l];
+            *bestj = (int)lj[l];
+        }
+    }
+
+    int restj = -1;
+    double rest = twoopt_row_best_scalar(inst, succ, dsucc, penalty, i,
+                                         first + k, count - k, &restj);
+    if (rest < best) {
+        best = rest;
+        *bestj = restj;
+    }
+
+    return best;
+}
+#endif
 double compute_zstar(instance inst, solution sol) {
     int nedges = sol->nedges;
 
@@ -174,27 +640,19 @@ int visitable(int* link, int nnodes) {
     return visits == nnodes - 1;
 }
 void reverse_path(int* succ, int nnodes, int start, int end) {
-    int* stack = (int*)malloc(nnodes * sizeof(int));
-    int k = 0;
-
-    stack[0] = start;
-    k++;
-
-    while (stack[k - 1] != end) {
-        if (stack[k - 1] == -1) {
-            printf("mad\n");
-        }
-        stack[k] = succ[stack[k - 1]];
-        k++;
+    /* in place: every node after start points back to its predecessor,
+     * succ[start] is left untouched */
+    int prev = start;
+    int cur = succ[start];
+
+    while (prev != end) {
+        assert(cur != -1 && "end not reachable from start");
+
+        int next = succ[cur];
+        succ[cur] = prev;
+        prev = cur;
+        cur = next;
     }
-
-    k--;
-    while (k >= 1) {
-        succ[stack[k]] = stack[k - 1];
-        k--;
-    }
-
-    free(stack);
 }
 
 /* edges representation convertes */
@@ -231,7 +689,7 @@ int* edges_tosucc(edge* edges, int nnodes) {
     return succ;
 }
 
-int* randomtour(int nnodes, unsigned int seedp) {
+int* randomtour(int nnodes, rng* r) {
     int* succ = (int*)malloc(nnodes * sizeof(int));
 
     int left_nodes = nnodes;
@@ -241,13 +699,13 @@ int* randomtour(int nnodes, unsigned int seedp) {
     int start, act, next;
     int pool_pick;
 
-    pool_pick = rand_r(&seedp) % left_nodes;
+    pool_pick = rng_int(r, left_nodes);
     start = act = pool[pool_pick];
     swap(&pool[pool_pick], &pool[left_nodes - 1]);
     left_nodes--;
 
     while (left_nodes > 0) {
-        pool_pick = rand_r(&seedp) % left_nodes;
+        pool_pick = rng_int(r, left_nodes);
         next = pool[pool_pick];
         swap(&pool[pool_pick], &pool[left_nodes - 1]);
 
@@ -279,6 +737,11 @@ int nodelexcmp(const void* a, const void* b) {
     if (fabs(na->x - nb->x) > EPSILON) return na->x < nb->x ? -1 : 1;
     return na->y < nb->y ? -1 : 1;
 }
+int nodeidxcmp(const void* a, const void* b, void* data) {
+    node* nodes = (node*)data;
+
+    return nodelexcmp(&nodes[*((int*)a)], &nodes[*((int*)b)]);
+}
 int pathcmp(const void* a, const void* b, void* data) {
     int* pathlenghts = (int*)data;
 
@@ -394,6 +857,9 @@ char* model_type_tostring(enum model_types model_type) {
         case GENETIC:
             snprintf(ans, bufsize, "genetic_algorithm");
             break;
+        case LIN_KERNIGHAN:
+            snprintf(ans, bufsize, "lin_kernighan");
+            break;
     }
 
     return ans;
@@ -414,6 +880,95 @@ char* model_folder_tostring(enum model_folders folder) {
     return ans;
 }
 
+char* distcache_type_tostring(enum distcache_types type) {
+    int bufsize = 100;
+    char* ans = (char*)calloc(bufsize, sizeof(char));
+
+    switch (type) {
+        case NO_CACHE:
+            snprintf(ans, bufsize, "none");
+            break;
+        case DOUBLE_CACHE:
+            snprintf(ans, bufsize, "double");
+            break;
+        case FLOAT_CACHE:
+            snprintf(ans, bufsize, "float");
+            break;
+        case INT_CACHE:
+            snprintf(ans, bufsize, "int");
+            break;
+        case ROW_CACHE:
+            snprintf(ans, bufsize, "rows");
+            break;
+    }
+
+    return ans;
+}
+char* candidate_type_tostring(enum candidate_types type) {
+    int bufsize = 100;
+    char* ans = (char*)calloc(bufsize, sizeof(char));
+
+    switch (type) {
+        case KNN_CANDIDATES:
+            snprintf(ans, bufsize, "knn");
+            break;
+        case DELAUNAY_CANDIDATES:
+            snprintf(ans, bufsize, "delaunay");
+            break;
+    }
+
+    return ans;
+}
+char* refinement_type_tostring(enum refinement_types type) {
+    int bufsize = 100;
+    char* ans = (char*)calloc(bufsize, sizeof(char));
+
+    switch (type) {
+        case TWOOPT_REFINEMENT:
+            snprintf(ans, bufsize, "twoopt");
+            break;
+        case TWOOPT_NEIGHBOR_REFINEMENT:
+            snprintf(ans, bufsize, "neighbor");
+            break;
+        case OROPT_REFINEMENT:
+            snprintf(ans, bufsize, "oropt");
+            break;
+        case LK_REFINEMENT:
+            snprintf(ans, bufsize, "lk");
+            break;
+    }
+
+    return ans;
+}
+char* crossover_type_tostring(enum crossover_types type) {
+    int bufsize = 100;
+    char* ans = (char*)calloc(bufsize, sizeof(char));
+
+    switch (type) {
+        case ORDER_CROSSOVER:
+            snprintf(ans, bufsize, "order");
+            break;
+        case EAX_CROSSOVER:
+            snprintf(ans, bufsize, "eax");
+            break;
+    }
+
+    return ans;
+}
+
+int heuristic_threads(instance inst) {
+    assert(inst != NULL);
+    assert(inst->params != NULL);
+
+    if (inst->params->num_threads > 0) return inst->params->num_threads;
+
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
 /* wall clock trackers */
 int64_t stopwatch(struct timespec* s, struct timespec* e) {
     /* if stopwatch not started yet, do if */